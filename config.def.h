@@ -33,13 +33,31 @@ static const Bool view_tag_toggles       = True; /* True means swtiching to a ta
 static const Bool hide_inactive_tags     = True; /* Don't display tags with no clients assigned to them (unless they're selected) */
 static const Bool resizehints            = False; /* True means respect size hints in tiled resizes */
 static const Bool hide_buried_windows    = True; /* True means clients that aren't floating, marked or at the top of the stack are moved off screen - only matters if you care about what's under transparent windows */
+static const Bool outline_moveresize     = False; /* True means mouse moves/resizes only draw an outline and resize the client once on release (can also be set per rule) */
+static const unsigned int outlinepx      = 2; /* width of the move/resize outline */
+static const unsigned int title_refresh_rate = 10; /* maximum number of title refreshes per second and client, the latest title is always shown eventually */
+static const Bool smart_placement        = True; /* True means new floating windows that don't ask for a position are placed where they overlap other floating windows the least */
+static const unsigned int stage_idle_time = 0; /* after this many idle milliseconds, lay out the next and previous occupied tags offscreen so switching to them only moves windows (0 disables) */
+static const int menu_lines              = 12;    /* rows of matches shown by the window switcher */
+static const Bool deprioritize_hidden   = False; /* True means processes whose windows are all on hidden tags or minimized get less CPU (can also be set per rule) */
+static const unsigned int deprioritize_delay = 5000; /* milliseconds a process has to stay hidden before it is deprioritized, it is restored as soon as a window shows */
+static const int hidden_nice             = 10;    /* nice value of deprioritized processes */
+static const char *hidden_cgroup         = NULL;  /* a delegated cgroup v2 directory to move deprioritized processes into instead of renicing them */
+static const unsigned int hidden_cpu_weight = 10; /* cpu.weight of hidden_cgroup (the default weight is 100) */
+static const unsigned int resource_sample_interval = 10000; /* milliseconds between samples of the clients' memory use and X server resources (needs XRES for the latter, 0 disables) */
+static const Bool show_icons            = True;  /* True means client bar tabs and the tag bar title show the clients' _NET_WM_ICON icons */
+static const Bool show_previews         = True;  /* True means hovering the client bar tab of a hidden client shows a thumbnail of it (needs XCOMPOSITE) */
+static const unsigned int preview_width  = 320;   /* maximum width and height of the thumbnails */
+static const unsigned int preview_delay  = 400;   /* milliseconds to hover a tab before its preview appears */
+static const unsigned int preview_refresh_rate = 2; /* thumbnail refreshes per second while a preview is shown */
+static const Bool show_client_resources = False; /* True means client bar tabs show their client's X server pixmap memory and resident memory */
 
 /*   Display modes of the client bar: never shown, always shown, shown only when there are offscreen windows */
 /*   A mode can be disabled by moving it after the show_clientbar_nmodes end marker */
 enum show_clientbar_modes { show_clientbar_never, show_clientbar_auto, show_clientbar_nmodes, show_clientbar_always };
 static const int show_clientbar          = show_clientbar_auto; /* Default client bar show mode  */
 
-/* tagging */
+/* tagging (more tags can be created at runtime, up to MAXTAGS in total) */
 static const char *tags[] = { "terminal", "1", "2", "3", "4", "5", "6", "7", "8" };
 /* default layout per tags */
 /* The first element is for all-tag view, following i-th element corresponds to */
@@ -53,14 +71,14 @@ static const Rule rules[] = {
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
 	 */
-	/* class      instance    title       tags mask     isfloating   monitor */
-	{ "Gimp",     NULL,       NULL,       0,            True,        -1 },
-	{ "Chromium", NULL,       NULL,       1 << 1,       False,       -1 },
-	{ "Geany",    NULL,       NULL,       1 << 1,       False,       -1 },
-	{ "MPlayer",  NULL,       NULL,       1 << 1,       True,        -1 },
-	{ "URxvt",    NULL,       NULL,       1 << 0,       False,       -1 },
-	{ "exe",      NULL,       NULL,       0,            True,        -1 }, /* fullscreen flash */
-	{ "FTL",	  NULL,		  NULL,		  0,			True,		 -1 },
+	/* class      instance    title       tags mask     isfloating   outline      monitor      deprioritize (-1: deprioritize_hidden) */
+	{ "Gimp",     NULL,       NULL,       0,            True,        False,       -1,          -1 },
+	{ "Chromium", NULL,       NULL,       1 << 1,       False,       False,       -1,          -1 },
+	{ "Geany",    NULL,       NULL,       1 << 1,       False,       False,       -1,          -1 },
+	{ "MPlayer",  NULL,       NULL,       1 << 1,       True,        True,        -1,          -1 },
+	{ "URxvt",    NULL,       NULL,       1 << 0,       False,       False,       -1,          -1 },
+	{ "exe",      NULL,       NULL,       0,            True,        False,       -1,          -1 }, /* fullscreen flash */
+	{ "FTL",	  NULL,		  NULL,		  0,			True,		 False,		  -1,		   -1 },
 };
 
 /* layout(s) */
@@ -77,10 +95,10 @@ static const Layout layouts[] = {
 /* key definitions */
 #define MODKEY Mod4Mask
 #define TAGKEYS(KEY,TAG) \
-	{ MODKEY,                       KEY,      cmd_view_tag,            {.ui = 1 << TAG} }, \
-	{ MODKEY|ControlMask,           KEY,      cmd_toggle_tag_view,     {.ui = 1 << TAG} }, \
-	{ MODKEY|ShiftMask,             KEY,      cmd_tag_client,          {.ui = 1 << TAG} }, \
-	{ MODKEY|ControlMask|ShiftMask, KEY,      cmd_toggle_tag,          {.ui = 1 << TAG} },
+	{ MODKEY,                       KEY,      cmd_view_tag,            {.i = TAG} }, \
+	{ MODKEY|ControlMask,           KEY,      cmd_toggle_tag_view,     {.i = TAG} }, \
+	{ MODKEY|ShiftMask,             KEY,      cmd_tag_client,          {.i = TAG} }, \
+	{ MODKEY|ControlMask|ShiftMask, KEY,      cmd_toggle_tag,          {.i = TAG} },
 
 /* helper for spawning shell commands in the pre dwm-5.0 fashion */
 #define SHCMD(cmd) { .v = (const char*[]){ "/bin/sh", "-c", cmd, NULL } }
@@ -92,10 +110,32 @@ static const char *volup[]    = { "volcontrol", "2.5%+", NULL};
 static const char *voldown[]  = { "volcontrol", "2.5%-", NULL};
 static const char *volmute[]  = { "volcontrol", "toggle", NULL};
 
+/* scratchpads: spawned once, then only shown and hidden (see cmd_toggle_scratchpad) */
+static const char *scratchtermcmd[] = { "urxvt", "-name", "scratchterm", NULL };
+static const char *scratchcalccmd[] = { "urxvt", "-name", "scratchcalc", "-e", "bc", "-l", NULL };
+static const Scratchpad scratchpads[] = {
+	/* instance      command          prespawn */
+	{ "scratchterm", scratchtermcmd,  True },
+	{ "scratchcalc", scratchcalccmd,  False },
+};
+
+/* macros: sequences of commands that run as one, with a single layout pass and repaint at the end */
+static const Action tile_on_3[] = {
+	/* function                 argument */
+	{ cmd_tag_client,           {.i = 3} },
+	{ cmd_view_tag,             {.i = 3} },
+	{ cmd_toggle_mark,          {0} },
+	{ cmd_set_layout,           {.v = &layouts[2]} },
+	{ NULL }
+};
+
 static Key keys[] = {
 	/* modifier                     key        function                       argument */
-	{ MODKEY,                       XK_r,      cmd_spawn,                     {.v = dmenucmd } },
+	{ MODKEY,                       XK_r,      cmd_launch,                    {0} },
+	{ MODKEY|ControlMask,           XK_r,      cmd_spawn,                     {.v = dmenucmd } },
 	{ MODKEY|ShiftMask,             XK_Return, cmd_spawn,                     {.v = termcmd } },
+	{ MODKEY,                       XK_Return, cmd_toggle_scratchpad,         {.i = 0 } }, /* show or hide the scratch terminal */
+	{ MODKEY,                       XK_equal,  cmd_toggle_scratchpad,         {.i = 1 } }, /* show or hide the calculator */
 	{ MODKEY,                       XK_d,      cmd_cycle_stackarea_selection, {.i = +1 } },
 	{ MODKEY,                       XK_a,      cmd_cycle_stackarea_selection, {.i = -1 } },
 	{ MODKEY|ShiftMask,             XK_d,      cmd_push_client_right,         {0} },
@@ -106,10 +146,15 @@ static Key keys[] = {
 	{ MODKEY,                       XK_s,      cmd_cycle_view,		          {.i = -1 } },
 	{ MODKEY|ShiftMask,             XK_w,      cmd_shift_tag,		          {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_s,      cmd_shift_tag,		          {.i = -1 } },
-	{ MODKEY,                       XK_Tab,    cmd_view_tag,                  {0} }, /* show previous tagset */
-	{ MODKEY,                       XK_0,      cmd_view_tag,                  {.ui = ~0 } }, /* show all tags */
-	{ MODKEY|ShiftMask,             XK_0,      cmd_tag_client,                {.ui = ~0 } }, /* tag client on all tags */
+	{ MODKEY,                       XK_Tab,    cmd_view_tag,                  {.i = PREVTAGS } }, /* show previous tagset */
+	{ MODKEY,                       XK_0,      cmd_view_tag,                  {.i = ALLTAGS } }, /* show all tags */
+	{ MODKEY|ShiftMask,             XK_0,      cmd_tag_client,                {.i = ALLTAGS } }, /* tag client on all tags */
+	{ MODKEY,                       XK_n,      cmd_create_tag,                {0} }, /* create and view a new tag */
+	{ MODKEY|ShiftMask,             XK_n,      cmd_name_tag,                  {0} }, /* name the current tag after the selected client */
+	{ MODKEY|ControlMask|ShiftMask, XK_n,      cmd_destroy_tag,               {0} }, /* destroy the current tag */
+	{ MODKEY,                       XK_slash,  cmd_switch_client,             {0} }, /* search and jump to a window */
 	{ MODKEY,                       XK_e,      cmd_toggle_mark,               {0} },
+	{ MODKEY|ShiftMask,             XK_m,      cmd_run_macro,                 {.v = tile_on_3 } }, /* move client to tag 3, view it, mark it and tile */
 	{ MODKEY|ShiftMask,             XK_h,      cmd_hide_window,               {0} },
 	{ MODKEY|ShiftMask,             XK_space,  cmd_toggle_floating,           {0} },
 	{ MODKEY,                       XK_f,      cmd_toggle_fullscreen,         {0} },
@@ -123,9 +168,14 @@ static Key keys[] = {
 	{ MODKEY,                       XK_space,  cmd_set_layout,                {0} },
 	{ MODKEY,                       XK_comma,  cmd_cycle_focus_monitor,       {.i = -1 } },
 	{ MODKEY,                       XK_period, cmd_cycle_focus_monitor,       {.i = +1 } },
+	{ MODKEY|ControlMask,           XK_Left,   cmd_focus_monitor,             {.i = DirLeft } },
+	{ MODKEY|ControlMask,           XK_Right,  cmd_focus_monitor,             {.i = DirRight } },
+	{ MODKEY|ControlMask,           XK_Up,     cmd_focus_monitor,             {.i = DirUp } },
+	{ MODKEY|ControlMask,           XK_Down,   cmd_focus_monitor,             {.i = DirDown } },
 	{ MODKEY|ShiftMask,             XK_comma,  cmd_send_to_monitor,           {.i = -1 } },
 	{ MODKEY|ShiftMask,             XK_period, cmd_send_to_monitor,           {.i = +1 } },
 	{ MODKEY|ShiftMask,             XK_q,      cmd_quit,                      {0} },
+	{ MODKEY|ShiftMask,             XK_r,      cmd_restart,                   {0} },
 	{ MODKEY,                       XK_t,      cmd_toggle_tagbar,             {0} },
 	{ MODKEY|ShiftMask,             XK_t,      cmd_set_clientbar_mode,        {.ui = -1 } },
 	{ MODKEY,                       XK_F8,     cmd_spawn,                     {.v = voldown } },
@@ -145,6 +195,18 @@ static Key keys[] = {
 	TAGKEYS(                        XK_8,      8)
 };
 
+/* key sequences: each key is pressed and released in turn, e.g. MODKEY+g, then t, then 3 */
+static const unsigned int chord_timeout = 1500; /* milliseconds to wait for the next key of a sequence */
+static const Chord chords[] = {
+	/* keys                                                function                 argument */
+	{ { { MODKEY, XK_g }, { 0, XK_t }, { 0, XK_3 } },      cmd_view_tag,            {.i = 3} },
+	{ { { MODKEY, XK_g }, { 0, XK_m }, { 0, XK_3 } },      cmd_tag_client,          {.i = 3} },
+	{ { { MODKEY, XK_g }, { 0, XK_n } },                   cmd_create_tag,          {0} },
+	{ { { MODKEY, XK_g }, { 0, XK_d } },                   cmd_destroy_tag,         {0} },
+	{ { { MODKEY, XK_g }, { 0, XK_l }, { 0, XK_t } },      cmd_set_layout,          {.v = &layouts[2]} },
+	{ { { MODKEY, XK_g }, { 0, XK_l }, { 0, XK_m } },      cmd_set_layout,          {.v = &layouts[1]} },
+};
+
 /* button definitions */
 /* click can be ClickLayoutSymbol, ClickStatusText, ClickWinTitle, ClickClientWin, or ClickRootWin */
 static Button buttons[] = {
@@ -156,11 +218,11 @@ static Button buttons[] = {
 	{ ClickClientWin,    MODKEY,         Button1,        cmd_drag_window,       {0} },
 	{ ClickClientWin,    MODKEY,         Button2,        cmd_toggle_floating,   {0} },
 	{ ClickClientWin,    MODKEY,         Button3,        cmd_resize_with_mouse, {0} },
-	{ ClickTagBar,       0,              Button1,        cmd_view_tag,          {0} },
-	{ ClickTagBar,       0,              Button3,        cmd_toggle_tag_view,   {0} },
-	{ ClickTagBar,       MODKEY,         Button1,        cmd_tag_client,        {0} },
-	{ ClickTagBar,       MODKEY,         Button3,        cmd_toggle_tag,        {0} },
-	{ ClickClientBar,    0,              Button1,        cmd_focus_client,      {0} },
+	{ ClickTagBar,       0,              Button1,        cmd_view_tag,          {.i = CLICKEDTAG } },
+	{ ClickTagBar,       0,              Button3,        cmd_toggle_tag_view,   {.i = CLICKEDTAG } },
+	{ ClickTagBar,       MODKEY,         Button1,        cmd_tag_client,        {.i = CLICKEDTAG } },
+	{ ClickTagBar,       MODKEY,         Button3,        cmd_toggle_tag,        {.i = CLICKEDTAG } },
+	{ ClickClientBar,    0,              Button1,        cmd_focus_client,      {.i = CLICKEDTAG } },
 	{ ClickWinTitle,     0,              Button2,        cmd_toggle_mark,       {0} },
-	{ ClickClientBar,    0,              Button3,        cmd_toggle_hidden,     {0} },
+	{ ClickClientBar,    0,              Button3,        cmd_toggle_hidden,     {.i = CLICKEDTAG } },
 };
@@ -14,12 +14,24 @@ X11LIB = /usr/X11R6/lib
 XINERAMALIBS  = -lXinerama
 XINERAMAFLAGS = -DXINERAMA
 
+# XRandR (1.5) for monitor hotplugging, comment if you don't want it
+XRANDRLIBS  = -lXrandr
+XRANDRFLAGS = -DXRANDR
+
+# XRes for per-client X server resource statistics, comment if you don't want it
+XRESLIBS  = -lXRes
+XRESFLAGS = -DXRES
+
+# XComposite and XRender for thumbnails of hidden clients, comment if you don't want it
+XCOMPOSITELIBS  = -lXcomposite -lXrender
+XCOMPOSITEFLAGS = -DXCOMPOSITE
+
 # includes and libs
 INCS = -I${X11INC}
-LIBS = -L${X11LIB} -lX11 ${XINERAMALIBS}
+LIBS = -L${X11LIB} -lX11 ${XINERAMALIBS} ${XRANDRLIBS} ${XRESLIBS} ${XCOMPOSITELIBS}
 
 # flags
-CPPFLAGS = -D_BSD_SOURCE -D_POSIX_C_SOURCE=2 -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS}
+CPPFLAGS = -D_DEFAULT_SOURCE -D_BSD_SOURCE -D_GNU_SOURCE -D_POSIX_C_SOURCE=200809L -DVERSION=\"${VERSION}\" ${XINERAMAFLAGS} ${XRANDRFLAGS} ${XRESFLAGS} ${XCOMPOSITEFLAGS}
 #CFLAGS   = -g -std=c99 -pedantic -Wall -O0 ${INCS} ${CPPFLAGS}
 CFLAGS   = -std=c99 -pedantic -Wall -Wno-deprecated-declarations -Os ${INCS} ${CPPFLAGS}
 LDFLAGS  = -s ${LIBS}
@@ -26,6 +26,7 @@
 #include "wasdwm.h"
 
 /* global variables */
+extern char **environ; /* passed to posix_spawnp() */
 const char broken[] = "broken";
 char stext[256];
 int screen;
@@ -35,8 +36,10 @@ int th = 0;           /* client bar geometry */
 int (*xerrorxlib)(Display *, XErrorEvent *);
 unsigned int numlockmask = 0;
 
-Atom wmatom[WMLast], netatom[NetLast];
+Atom wmatom[WMLast], netatom[NetLast], wasdwmatom[WasdwmLast], utf8string;
 Bool running = True;
+Bool restarting = False;
+Bool show_timings = False; /* print a breakdown of the startup time (-t) */
 Cursor cursor[CursorLast];
 ColorScheme scheme[SchemeLast];
 Display *dpy;
@@ -44,6 +47,56 @@ Graphics *drw;
 FontStruct *fnt;
 Monitor *mons, *selmon;
 Window root;
+Window outline_wins[4]; /* top, bottom, left and right edges of the move/resize outline */
+Window wmcheckwin;    /* _NET_SUPPORTING_WM_CHECK window, also carries the _WASDWM_STATS property */
+Timer *timers;        /* armed timers, sorted by due time */
+Rate wakeups;         /* reads from the X connection */
+MonitorIndex monindex; /* monitors by number and position */
+Timer statstimer = { .func = update_stats };
+Timer screentimer = { .func = update_screens };	/* collects bursts of screen configuration events */
+Timer stagetimer = { .func = stage_adjacent_tags };
+Menu menu;            /* the switcher and launcher overlay, see menu_open() */
+Preview preview;      /* thumbnail of a hidden client whose tab is hovered, see event_motion_notify() */
+Timer previewtimer = { .func = preview_update };
+PathDir *pathdirs;    /* the directories in $PATH, see path_index_init() */
+int npathdirs;
+char **pathnames;     /* sorted names of all executables in $PATH */
+int npathnames;
+int inotifyfd = -1;
+Timer pathtimer = { .func = path_index_update };
+Spawn spawns[MAXSPAWNS]; /* ring buffer of recently spawned processes, see spawn_record() */
+unsigned int nextspawn;
+SpawnStats spawnstats[MAXSPAWNSTATS];
+long long scratchtime[LENGTH(scratchpads)]; /* when each scratchpad was last spawned, 0 if its window came and went */
+Bool scratchshow[LENGTH(scratchpads)];      /* show the scratchpad as soon as its window appears */
+ProcPriority procprios[MAXPROCPRIOS]; /* processes of clients that may be deprioritized, see update_priorities() */
+int nprocprios;
+Bool hidden_cgroup_ready = False; /* hidden_cgroup exists and has its cpu.weight set */
+int nice_floor = 20;  /* lowest nice value the WM may set, see priority_init() */
+Timer priotimer = { .func = update_priorities };
+Timer resourcetimer = { .func = update_resources };
+Icon *icons;          /* scaled client icons, shared between clients with identical ones */
+unsigned int iconsize; /* icons are scaled to fit the bars */
+Bool staging = False; /* resize_client() keeps windows offscreen, see stage_tag() */
+KeyNode *keytrie;     /* first keys of the key sequences, see chord_build() */
+KeyNode *keymode;     /* position in the key sequence being typed, NULL if none */
+Timer chordtimer = { .func = chord_cancel };
+int batching = 0;     /* nesting depth of run_actions(), arranging, restacking and bar drawing wait while > 0 */
+Tagset tagmask;       /* existing tags, see cmd_create_tag() */
+unsigned int numtags; /* one past the highest existing tag */
+char tagnames[MAXTAGS][TAGNAMELEN];
+#ifdef XRANDR
+Bool randr_active = False;	/* RandR 1.5 is available, monitors are tracked through it */
+int randr_event_base;
+Monitor *dormant;     /* monitors whose outputs went away, kept with their settings in case they come back */
+#endif /* XRANDR */
+#ifdef XCOMPOSITE
+Bool composite_active = False; /* the X server can capture windows (Composite 0.2) and scale them (Render) */
+#endif /* XCOMPOSITE */
+#ifdef XRES
+Bool xres_active = False; /* the X server has the XRes extension */
+int xres_event_base, xres_error_base;
+#endif /* XRES */
 
 /* function implementations */
 
@@ -61,11 +114,19 @@ apply_rules (Client *c) {
 	XClassHint ch = {NULL, NULL};
 
 	/* rule matching */
-	c->isfloating = c->tags = 0;
+	c->isfloating = c->outline = 0;
+	c->deprioritize = deprioritize_hidden;
+	memset(&c->tags, 0, sizeof c->tags);
 	XGetClassHint(dpy, c->win, &ch);
 	class    = ch.res_class ? ch.res_class : broken;
 	instance = ch.res_name  ? ch.res_name  : broken;
+	snprintf(c->class, sizeof c->class, "%s", class);
 
+	for (i = 0; i < LENGTH(scratchpads); i++) {
+		if (!strcmp(instance, scratchpads[i].instance)) {
+			c->scratchpad = i + 1;
+		}
+	}
 	for (i = 0; i < LENGTH(rules); i++) {
 		r = &rules[i];
 		if ((!r->title || strstr(c->name, r->title))
@@ -73,7 +134,11 @@ apply_rules (Client *c) {
 				&& (!r->instance || strstr(instance, r->instance)))	{
 					
 			c->isfloating = r->isfloating;
-			c->tags |= r->tags;
+			c->outline |= r->outline;
+			if (r->deprioritize >= 0) {
+				c->deprioritize = r->deprioritize;
+			}
+			c->tags.w[0] |= r->tags; /* the first word holds the first TAGWORDBITS tags */
 			for (m = mons; m && m->num != r->monitor; m = m->next);
 			if (m) {
 				c->mon = m;
@@ -86,8 +151,21 @@ apply_rules (Client *c) {
 	if (ch.res_name) {
 		XFree(ch.res_name);
 	}
+	if (c->scratchpad) { /* floating and on no tag until it is summoned */
+		c->isfloating = True;
+		c->mon = selmon;
+		memset(&c->tags, 0, sizeof c->tags);
+		if (scratchshow[c->scratchpad - 1]) {
+			scratchshow[c->scratchpad - 1] = False;
+			c->tags = selmon->tagset[selmon->selected_tags];
+		}
+		return;
+	}
 		
-	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->selected_tags];
+	tagset_and(&c->tags, &tagmask);
+	if (tagset_empty(&c->tags)) {
+		c->tags = c->mon->tagset[c->mon->selected_tags];
+	}
 }
 
 /**
@@ -176,7 +254,7 @@ apply_size_hints (Client *c, int *x, int *y, int *w, int *h, Bool interact) {
 }
 
 /**
- * Arranges clients on screen using the current layout.
+ * Arranges clients on screen using the current layout. Inside run_actions this is deferred until the macro ends.
  * 
  * @param	m	The target monitor.  Passing NULL arranges all monitors.
  */
@@ -186,14 +264,18 @@ arrange (Monitor *m) {
 		for (m = mons; m; m = m->next) {
 			arrange(m);
 		}
+	} else if (batching) {
+		m->deferred |= DeferArrange;
 	} else {
+		schedule_priority_update();
 		update_onscreen(m);
 		update_visibility(m->stack);
 		update_bar_positions(m);
 		
 		strncpy(m->layout_symbol, m->layout[m->selected_layout]->symbol, sizeof m->layout_symbol);
-		if (m->layout[m->selected_layout]->arrange) {
+		if (m->layout[m->selected_layout]->arrange && !layout_cache_apply(m)) {
 			m->layout[m->selected_layout]->arrange(m);
+			layout_cache_store(m);
 		}
 	}
 }
@@ -295,6 +377,7 @@ arrange_tile (Monitor *m) {
  */
 void
 attach (Client *c) {
+	c->mon->version++;
 	if (c->isfloating) {
 		c->next = c->mon->clients;
 		c->mon->clients = c;
@@ -328,26 +411,221 @@ attach_recursive (Client *c, Client *pos) {
 	}
 }
 
+/**
+ * Times place_client against growing numbers of random floating windows on a fake 1920x1080 monitor and prints
+ * the average cost of a placement. Doesn't need an X display; run with -b.
+ */
+void
+benchmark_placement (void) {
+	static const int counts[] = { 10, 100, 300, 1000 };
+	unsigned int i;
+	int j, k, runs;
+	double us;
+	struct timespec start, end;
+	Monitor m = { 0 };
+	Client *cs, c;
+
+	srand(1);
+	m.winarea_width = 1920;
+	m.winarea_height = 1080;
+	for (i = 0; i < LENGTH(counts); i++) {
+		if (!(cs = calloc(counts[i], sizeof(Client)))) {
+			die("fatal: could not malloc() %u bytes\n", counts[i] * sizeof(Client));
+		}
+		for (j = 0; j < counts[i]; j++) {
+			cs[j].w = 100 + rand() % 500;
+			cs[j].h = 100 + rand() % 400;
+			cs[j].x = rand() % (m.winarea_width - cs[j].w);
+			cs[j].y = rand() % (m.winarea_height - cs[j].h);
+			cs[j].bw = 1;
+			cs[j].isfloating = True;
+			cs[j].mon = &m;
+			TAGSET_ADD(cs[j].tags, 0);
+			cs[j].next = j + 1 < counts[i] ? &cs[j + 1] : NULL;
+		}
+		m.clients = cs;
+		runs = MAX(1, 20000 / counts[i]);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (k = 0; k < runs; k++) {
+			memset(&c, 0, sizeof(Client));
+			c.w = 400;
+			c.h = 300;
+			c.bw = 1;
+			c.isfloating = True;
+			c.mon = &m;
+			TAGSET_ADD(c.tags, 0);
+			place_client(&c);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		us = ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / runs;
+		printf("place_client: %5d windows %10.1f us/placement (%d runs)\n", counts[i], us, runs);
+		free(cs);
+	}
+}
+
+/**
+ * Compiles the key sequences in chords into a trie of KeyNodes, so each key of a sequence is looked up among the
+ * keys that may follow the previous one only. A sequence that is a prefix of another one shadows it.
+ */
+void
+chord_build (void) {
+	unsigned int i, j;
+	KeyNode **np, *n, *parent;
+
+	for (i = 0; i < LENGTH(chords); i++) {
+		parent = NULL;
+		np = &keytrie;
+		for (j = 0; j < MAXCHORD && chords[i].keys[j].keysym != NoSymbol; j++) {
+			for (; *np && ((*np)->key.keysym != chords[i].keys[j].keysym
+					|| CLEANMASK((*np)->key.mod) != CLEANMASK(chords[i].keys[j].mod)); np = &(*np)->next);
+			if (!(n = *np)) {
+				if (!(n = *np = calloc(1, sizeof(KeyNode)))) {
+					die("fatal: could not malloc() %u bytes\n", sizeof(KeyNode));
+				}
+				n->key = chords[i].keys[j];
+			}
+			parent = n;
+			np = &n->child;
+		}
+		if (parent && !parent->chord) {
+			parent->chord = &chords[i];
+		}
+	}
+}
+
+/**
+ * Leaves the key sequence being typed and releases the keyboard. Also called by chordtimer when the next key
+ * doesn't come in time (see chord_timeout).
+ * 
+ * @param	unused	Unused.
+ */
+void
+chord_cancel (void *unused) {
+	if (!keymode) return;
+	keymode = NULL;
+	timer_disarm(&chordtimer);
+	XUngrabKeyboard(dpy, CurrentTime);
+}
+
+/**
+ * Frees a key sequence trie.
+ * 
+ * @param	n	The first node of the trie's top level.
+ */
+void
+chord_free (KeyNode *n) {
+	KeyNode *next;
+
+	for (; n; n = next) {
+		next = n->next;
+		chord_free(n->child);
+		free(n);
+	}
+}
+
+/**
+ * Advances the key sequence being typed, or starts a new one. While a sequence is being typed, the whole keyboard
+ * is grabbed and every key press ends up here; keys that don't continue the sequence cancel it.
+ * Returns True if the key was used.
+ * 
+ * @param	ev		The key event.
+ * @param	keysym	The key that was pressed.
+ */
+Bool
+chord_press (XKeyEvent *ev, KeySym keysym) {
+	KeyNode *n;
+
+	if (keymode && IsModifierKey(keysym)) return True;
+	for (n = keymode ? keymode->child : keytrie;
+			n && (n->key.keysym != keysym || CLEANMASK(n->key.mod) != CLEANMASK(ev->state)); n = n->next);
+	if (!n) {
+		if (!keymode) return False;
+		chord_cancel(NULL);
+		return True;
+	}
+	if (n->chord) {
+		chord_cancel(NULL);
+		if (n->chord->func) {
+			n->chord->func(&n->chord->arg);
+		}
+		return True;
+	}
+	if (!keymode && XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess) {
+		return True;
+	}
+	keymode = n;
+	timer_arm(&chordtimer, chord_timeout);
+	return True;
+}
+
 /**
  * Releases resources upon shutdown.
  */
 void
 cleanup (void) {
-	Arg a = { .ui = ~0 };
+	Arg a = { .i = ALLTAGS };
 	Layout foo = { "", NULL };
+	Client *c;
 	Monitor *m;
+#ifdef XRANDR
+	int i;
+#endif /* XRANDR */
 
-	cmd_view_tag(&a);
-	selmon->layout[selmon->selected_layout] = &foo;
-	for (m = mons; m; m = m->next) {
-		while (m->stack) {
-			unmanage(m->stack, False);
+	if (restarting) { /* leave the windows as they are, the next process takes them over */
+		for (m = mons; m; m = m->next) {
+			while ((c = m->clients)) {
+				m->clients = c->next;
+				free(c);
+			}
+		}
+	} else {
+		for (m = mons; m; m = m->next) {
+			for (c = m->clients; c; c = c->next) {
+				if (c->scratchpad) { /* hidden ones have no tags, bring them back on screen too */
+					c->tags = tagmask;
+				}
+			}
+		}
+		cmd_view_tag(&a);
+		selmon->layout[selmon->selected_layout] = &foo;
+		for (m = mons; m; m = m->next) {
+			while (m->stack) {
+				unmanage(m->stack, False);
+			}
 		}
 	}
+	menu_close();
+	preview_close();
+	chord_cancel(NULL);
+	chord_free(keytrie);
+	path_index_free();
+	timer_disarm(&priotimer);
+	while (nprocprios) { /* give everything its priority back, a restart starts over */
+		priority_restore(&procprios[--nprocprios]);
+	}
 	XUngrabKey(dpy, AnyKey, AnyModifier, root);
 	while (mons) {
 		monitor_cleanup(mons);
 	}
+#ifdef XRANDR
+	while ((m = dormant)) { /* their windows are gone already */
+		dormant = m->next;
+		free(m->xedges.edges);
+		free(m->yedges.edges);
+		for (i = 0; i <= MAXTAGS; i++) {
+			if (m->pertag->tags[i]) {
+				free(m->pertag->tags[i]->cache.geoms);
+				free(m->pertag->tags[i]);
+			}
+		}
+		free(m->pertag);
+		free(m);
+	}
+#endif /* XRANDR */
+	free(monindex.mons);
+	free(monindex.xs);
+	free(monindex.ys);
+	free(monindex.cells);
 	XFreeCursor(drw->dpy, cursor[CursorNormal]);
 	XFreeCursor(drw->dpy, cursor[CursorResize]);
 	XFreeCursor(drw->dpy, cursor[CursorMove]);
@@ -368,11 +646,28 @@ cleanup (void) {
 	color_free(scheme[SchemeUrgent].bg);
 	color_free(scheme[SchemeUrgent].fg);
 	gfx_free(drw);
+	XDestroyWindow(dpy, wmcheckwin);
 	XSync(dpy, False);
 	XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
 	XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
 }
 
+/**
+ * Forgets a client in the selection remembered for each tag of its monitor, before it leaves that monitor for good.
+ * 
+ * @param	c	The target client.
+ */
+void
+clear_tag_selection (Client *c) {
+	int i;
+
+	for (i = 0; i <= MAXTAGS; i++) {
+		if (c->mon->pertag->tags[i] && c->mon->pertag->tags[i]->sel == c) {
+			c->mon->pertag->tags[i]->sel = NULL;
+		}
+	}
+}
+
 /**
  * Clears the urgent flag on the window associated with a given client.
  * 
@@ -402,10 +697,35 @@ cmd_adjust_marked_width (const Arg *arg) {
 	if (!arg || !selmon->layout[selmon->selected_layout]->arrange) return;
 	f = arg->f + selmon->marked_width;
 	if (f < 0.1 || f > 0.9) return;
-	selmon->marked_width = selmon->pertag->marked_widths[selmon->pertag->curtag] = f;
+	selmon->marked_width = get_tag_state(selmon, selmon->pertag->curtag)->marked_width = f;
 	arrange(selmon);
 }
 
+/**
+ * Command: Creates a new tag in the first free slot and views it.
+ * 
+ * @param	arg	arg->v holds the name of the new tag, if NULL the tag is named after its index.
+ */
+void
+cmd_create_tag (const Arg *arg) {
+	int i;
+	Arg a;
+
+	for (i = 0; i < MAXTAGS && TAGSET_HAS(tagmask, i); i++);
+	if (i == MAXTAGS) return;
+	
+	if (arg && arg->v) {
+		snprintf(tagnames[i], TAGNAMELEN, "%s", (const char *)arg->v);
+	} else {
+		snprintf(tagnames[i], TAGNAMELEN, "%d", i);
+	}
+	TAGSET_ADD(tagmask, i);
+	numtags = MAX(numtags, (unsigned int)i + 1);
+	a.i = i;
+	cmd_view_tag(&a);
+	draw_bars();
+}
+
 /**
  * Command: Cycles the focus to the next (or previous) tiled client, raising if necessary.
  * 
@@ -508,45 +828,91 @@ cmd_cycle_stackarea_selection (const Arg *arg) {
  */
 void
 cmd_cycle_view (const Arg *arg) {
-	unsigned int occ = 0;
-	int i, curtags;
-	int seltag = 0;
-	Client* c = NULL;
+	int seltag;
 	Arg a;
 
-	for (c = selmon->clients; c; c = c->next) {
-		occ |= c->tags;
+	if ((seltag = next_occupied_tag(selmon, arg->i)) < 0) return;
+
+	a.i = seltag;
+	cmd_view_tag(&a);
+}
+
+/**
+ * Command: Destroys the current tag and frees its state on all monitors. Clients that aren't tagged with
+ * any other tag move to the previously viewed tag. The last remaining tag can't be destroyed.
+ * 
+ * @param	arg	Unused.
+ */
+void
+cmd_destroy_tag (const Arg *arg) {
+	int i, tag = (int)selmon->pertag->curtag - 1, target;
+	Client *c;
+	Monitor *m;
+	TagState *st;
+
+	if (tag < 0) return;
+	TAGSET_DEL(tagmask, tag);
+	if (tagset_empty(&tagmask)) {
+		TAGSET_ADD(tagmask, tag);
+		return;
 	}
-		
-	if (occ == 0) return;
-	
-	curtags = selmon->tagset[selmon->selected_tags];
-	for (i = 0; i < LENGTH(tags); i++) {
-		if (curtags & (1 << i)){
-			seltag = i;
-			break;
-		}
+	target = (int)selmon->pertag->prevtag - 1;
+	if (target < 0 || !TAGSET_HAS(tagmask, target)) {
+		target = tagset_first(&tagmask);
 	}
+	for (numtags = MAXTAGS; !TAGSET_HAS(tagmask, numtags - 1); numtags--);
 	
-	do {
-		seltag = (seltag + arg->i) % (int)LENGTH(tags);
-		if (seltag < 0) {
-			seltag += LENGTH(tags);
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = c->next) {
+			TAGSET_DEL(c->tags, tag);
+			if (tagset_empty(&c->tags) && !c->scratchpad) { /* a scratchpad without tags is just hidden */
+				TAGSET_ADD(c->tags, target);
+			}
 		}
-	} while (!((1 << seltag) & occ));
-
-	a.i = (1 << seltag);
-	cmd_view_tag(&a);
+		for (i = 0; i < 2; i++) {
+			TAGSET_DEL(m->tagset[i], tag);
+			if (tagset_empty(&m->tagset[i])) {
+				TAGSET_ADD(m->tagset[i], target);
+			}
+		}
+		if ((st = m->pertag->tags[tag + 1])) {
+			free(st->cache.geoms);
+			free(st);
+			m->pertag->tags[tag + 1] = NULL;
+		}
+		if (m->pertag->prevtag == tag + 1) {
+			m->pertag->prevtag = target + 1;
+		}
+		if (m->pertag->curtag != tag + 1) continue;
+
+		/* the monitor was viewing the tag, apply the settings of the tag it falls back to */
+		m->pertag->curtag = tagset_first(&m->tagset[m->selected_tags]) + 1;
+		st = get_tag_state(m, m->pertag->curtag);
+		m->marked_width = st->marked_width;
+		m->selected_layout = st->selected_layout;
+		m->layout[m->selected_layout] = st->layoutidxs[m->selected_layout];
+		m->layout[m->selected_layout^1] = st->layoutidxs[m->selected_layout^1];
+		if (m->show_tagbar != st->show_tagbar) {
+			m->show_tagbar = st->show_tagbar;
+			update_bar_positions(m);
+			XMoveResizeWindow(dpy, m->tagbar_win, m->winarea_x, m->tagbar_pos, m->winarea_width, bh);
+		}
+	}
+	focus(get_tag_selection(selmon));
+	arrange(NULL);
+	draw_bars();
 }
 
 /**
  * Command: Activate mouse based window placement.
+ * In outline mode only a frame is moved around and the client is moved once the button is released.
  * 
  * @param	arg	Unused.
  */
 void
 cmd_drag_window (const Arg *arg) {
 	int x, y, ocx, ocy, nx, ny;
+	Bool outline, moved = False;
 	Client *c;
 	Monitor *m;
 	XEvent ev;
@@ -560,8 +926,12 @@ cmd_drag_window (const Arg *arg) {
 						
 	if (!get_root_pointer_pos(&x, &y)) return;
 	
-	ocx = c->x;
-	ocy = c->y;
+	ocx = nx = c->x;
+	ocy = ny = c->y;
+	outline = outline_moveresize || c->outline;
+	if (outline) {
+		outline_create();
+	}
 
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
@@ -574,6 +944,7 @@ cmd_drag_window (const Arg *arg) {
 			case MotionNotify:
 				nx = ocx + (ev.xmotion.x - x);
 				ny = ocy + (ev.xmotion.y - y);
+				snap_to_clients(c, &nx, &ny);
 				if (nx >= selmon->winarea_x && nx <= selmon->winarea_x + selmon->winarea_width
 				&& ny >= selmon->winarea_y && ny <= selmon->winarea_y + selmon->winarea_height) {
 					if (abs(selmon->winarea_x - nx) < snap) {
@@ -592,11 +963,22 @@ cmd_drag_window (const Arg *arg) {
 					}
 				}
 				if (!selmon->layout[selmon->selected_layout]->arrange || c->isfloating) {
-					resize(c, nx, ny, c->w, c->h, True);
+					if (outline) {
+						outline_move(nx, ny, WIDTH(c), HEIGHT(c));
+						moved = True;
+					} else {
+						resize(c, nx, ny, c->w, c->h, True);
+					}
 				}
 				break;
 		}
 	} while (ev.type != ButtonRelease);
+	if (outline) {
+		outline_free();
+		if (moved) {
+			resize(c, nx, ny, c->w, c->h, True);
+		}
+	}
 	XUngrabPointer(dpy, CurrentTime);
 	if ((m = rect_to_monitor(c->x, c->y, c->w, c->h)) != selmon) {
 		send_client_to_monitor(c, m);
@@ -630,6 +1012,22 @@ cmd_focus_client (const Arg* arg){
   }
 }
 
+/**
+ * Command: Focuses the nearest monitor in a given direction.
+ * 
+ * @param	arg	arg->i is one of DirLeft, DirRight, DirUp and DirDown.
+ */
+void
+cmd_focus_monitor (const Arg *arg) {
+	Monitor *m;
+
+	if (arg->i < 0 || arg->i >= DirLast || !(m = selmon->neighbours[arg->i])) return;
+
+	unfocus(selmon->sel);
+	selmon = m;
+	focus(NULL);
+}
+
 /**
  * Command: Minimizes the currently selected window.
  * 
@@ -667,6 +1065,59 @@ cmd_kill_client (const Arg *arg) {
 	}
 }
 
+/**
+ * Command: Opens the launcher, which searches the executables in $PATH and spawns the chosen one.
+ * The index is kept up to date in the background (see path_index_update), so nothing is scanned here.
+ * 
+ * @param	arg	Unused.
+ */
+void
+cmd_launch (const Arg *arg) {
+	int i;
+	struct stat st;
+	MenuItem *items;
+
+	for (i = 0; i < npathdirs; i++) {
+		if (pathdirs[i].wd >= 0) continue;
+		/* no change notifications (yet), e.g. the directory didn't exist: look at the directory itself */
+		if (path_index_watch(&pathdirs[i])
+				|| (!stat(pathdirs[i].path, &st) && st.st_mtime != pathdirs[i].mtime)) {
+			pathdirs[i].stale = True;
+		}
+	}
+	menu_close(); /* the index can't change while the launcher shows it */
+	path_index_update(NULL);
+	if (!(items = malloc((npathnames + 1) * sizeof(MenuItem)))) {
+		die("fatal: could not malloc() %u bytes\n", (npathnames + 1) * sizeof(MenuItem));
+	}
+	for (i = 0; i < npathnames; i++) {
+		items[i].text = pathnames[i];
+		items[i].data = NULL;
+	}
+	menu_open(items, npathnames, NULL, launcher_select);
+}
+
+/**
+ * Command: Renames the current tag.
+ * 
+ * @param	arg	arg->v holds the new name. If NULL, the tag is named after the class of the selected client,
+ * 				or after its index if no client is selected.
+ */
+void
+cmd_name_tag (const Arg *arg) {
+	int tag = (int)selmon->pertag->curtag - 1;
+
+	if (tag < 0) return;
+	if (arg && arg->v) {
+		snprintf(tagnames[tag], TAGNAMELEN, "%s", (const char *)arg->v);
+	} else if (selmon->sel && selmon->sel->class[0]) {
+		snprintf(tagnames[tag], TAGNAMELEN, "%.*s", TAGNAMELEN - 1, selmon->sel->class);
+	} else {
+		snprintf(tagnames[tag], TAGNAMELEN, "%d", tag);
+	}
+	draw_bars();
+}
+
 /**
  * Command: Cycles the selected client up (leftward) in its monitor's client list.
  * 
@@ -738,13 +1189,15 @@ cmd_quit (const Arg *arg) {
 
 /**
  * Command: Activates mouse-based window resizing.
+ * In outline mode only a frame is resized and the client is resized once the button is released.
  * 
  * @param	arg	Unused.
  */
 void
 cmd_resize_with_mouse (const Arg *arg) {
 	int ocx, ocy;
-	int nw, nh;
+	int nx, ny, nw, nh;
+	Bool outline, moved = False;
 	Client *c;
 	Monitor *m;
 	XEvent ev;
@@ -758,6 +1211,12 @@ cmd_resize_with_mouse (const Arg *arg) {
 			
 	ocx = c->x;
 	ocy = c->y;
+	nw = c->w;
+	nh = c->h;
+	outline = outline_moveresize || c->outline;
+	if (outline) {
+		outline_create();
+	}
 	XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
 	do {
 		XMaskEvent(dpy, MOUSEMASK|ExposureMask|SubstructureRedirectMask, &ev);
@@ -779,11 +1238,26 @@ cmd_resize_with_mouse (const Arg *arg) {
 				}
 			}
 			if (!selmon->layout[selmon->selected_layout]->arrange || c->isfloating) {
-				resize(c, c->x, c->y, nw, nh, True);
+				if (outline) {
+					/* show the geometry the client will actually get */
+					nx = c->x;
+					ny = c->y;
+					apply_size_hints(c, &nx, &ny, &nw, &nh, True);
+					outline_move(nx, ny, nw + 2 * c->bw, nh + 2 * c->bw);
+					moved = True;
+				} else {
+					resize(c, c->x, c->y, nw, nh, True);
+				}
 			}
 			break;
 		}
 	} while (ev.type != ButtonRelease);
+	if (outline) {
+		outline_free();
+		if (moved) {
+			resize(c, c->x, c->y, nw, nh, True);
+		}
+	}
 	XWarpPointer(dpy, None, c->win, 0, 0, 0, 0, c->w + c->bw - 1, c->h + c->bw - 1);
 	XUngrabPointer(dpy, CurrentTime);
 	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
@@ -794,6 +1268,38 @@ cmd_resize_with_mouse (const Arg *arg) {
 	}
 }
 
+/**
+ * Command: Restarts the WM in place.
+ * The state of all monitors and clients is saved on the root window and picked up again by the new process.
+ * 
+ * @param	arg	Unused.
+ */
+void
+cmd_restart (const Arg *arg) {
+	restarting = True;
+	running = False;
+}
+
+/**
+ * Command: Runs a sequence of commands as one, with a single layout pass and repaint at the end.
+ * 
+ * @param	arg	arg->v points to an array of Actions terminated by one without a function (see config.h).
+ */
+void
+cmd_run_macro (const Arg *arg) {
+	run_actions((const Action *)arg->v, -1);
+}
+
+/**
+ * Command: Samples the clients' memory use and X server resources right away instead of waiting for the timer.
+ * 
+ * @param	arg	Unused.
+ */
+void
+cmd_sample_resources (const Arg *arg) {
+	update_resources(NULL);
+}
+
 /**
  * Command: Sends the currently selected client to the next/previous monitor.
  * 
@@ -827,14 +1333,16 @@ cmd_set_clientbar_mode (const Arg *arg) {
  */
 void
 cmd_set_layout (const Arg *arg) {
+	TagState *st = get_tag_state(selmon, selmon->pertag->curtag);
+
 	if (!arg || !arg->v || arg->v != selmon->layout[selmon->selected_layout]) {
-		selmon->pertag->selected_layouts[selmon->pertag->curtag] ^= 1;
-		selmon->selected_layout = selmon->pertag->selected_layouts[selmon->pertag->curtag];
+		st->selected_layout ^= 1;
+		selmon->selected_layout = st->selected_layout;
 	}
 	if (arg && arg->v) {
-		selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout] = (Layout *)arg->v;
+		st->layoutidxs[selmon->selected_layout] = (Layout *)arg->v;
 	}
-	selmon->layout[selmon->selected_layout] = selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout];
+	selmon->layout[selmon->selected_layout] = st->layoutidxs[selmon->selected_layout];
 	strncpy(selmon->layout_symbol, selmon->layout[selmon->selected_layout]->symbol, sizeof selmon->layout_symbol);
 	
 	arrange(selmon);	/* which of these is necessary? */
@@ -852,7 +1360,7 @@ cmd_set_marked_width (const Arg *arg) {
 	if (!arg || !selmon->layout[selmon->selected_layout]->arrange
 			|| arg->f < 0.1 || arg->f > 0.9 ) return;
 	
-	selmon->marked_width = selmon->pertag->marked_widths[selmon->pertag->curtag] = arg->f;
+	selmon->marked_width = get_tag_state(selmon, selmon->pertag->curtag)->marked_width = arg->f;
 	arrange(selmon);
 }
 
@@ -863,66 +1371,107 @@ cmd_set_marked_width (const Arg *arg) {
  */
 void
 cmd_shift_tag (const Arg *arg) {
-	unsigned int occ = 0;
-	int i, curtags;
-	int seltag = 0;
-	Client* c = NULL;
+	int seltag;
 	Arg a;
 
-	for (c = selmon->clients; c; c = c->next) {
-		occ |= c->tags;
-	}
-		
-	if (occ == 0) return;
+	if (!selmon->clients || !numtags) return;
 	
-	curtags = selmon->tagset[selmon->selected_tags];
-	for (i = 0; i < LENGTH(tags); i++) {
-		if (curtags & (1 << i)){
-			seltag = i;
-			break;
-		}
+	if ((seltag = tagset_first(&selmon->tagset[selmon->selected_tags])) < 0) {
+		seltag = 0;
 	}
 	
-	seltag = (seltag + arg->i) % (int)LENGTH(tags);
-	if (seltag < 0) {
-		seltag += LENGTH(tags);
-	}
+	do {
+		seltag = (seltag + arg->i) % (int)numtags;
+		if (seltag < 0) {
+			seltag += numtags;
+		}
+	} while (!TAGSET_HAS(tagmask, seltag));
 
-	a.ui = (1 << seltag);
+	a.i = seltag;
 	cmd_tag_client(&a);
 }
 
 /**
- * Command: Spawns a child process.
+ * Command: Spawns a child process in a session (or, where posix_spawn can't do that, a process group) of its own.
+ * The WM's descriptors are all close-on-exec, so the child only inherits stdin, stdout and stderr.
  * 
  * @param	arg	The process to be spawned is determined by arg->v (see config.h).
  */
 void
 cmd_spawn (const Arg *arg) {
-	if (fork() == 0) {
-		if (dpy) {
-			close(ConnectionNumber(dpy));
+	char **argv = (char **)arg->v;
+	int err;
+	pid_t pid;
+	posix_spawnattr_t attr;
+
+	posix_spawnattr_init(&attr);
+#ifdef POSIX_SPAWN_SETSID
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#else
+	posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP); /* the process group defaults to the child's pid */
+#endif /* POSIX_SPAWN_SETSID */
+	err = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+	if (err) {
+		fprintf(stderr, "wasdwm: posix_spawnp %s failed: %s\n", argv[0], strerror(err));
+		return;
+	}
+	spawn_record(pid, argv);
+}
+
+/**
+ * Command: Opens the window switcher, which lists the clients of all monitors (the selected monitor and the most
+ * recently focused clients first) and jumps to the one chosen by searching their titles and classes.
+ * 
+ * @param	arg	Unused.
+ */
+void
+cmd_switch_client (const Arg *arg) {
+	int i, n = 0;
+	char *labels;
+	Bool first;
+	MenuItem *items;
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next) {
+		for (c = m->stack; c; c = c->snext, n++);
+	}
+	if (!n) return;
+	if (!(items = malloc(n * sizeof(MenuItem))) || !(labels = malloc(n * SWITCHERLABELLEN))) {
+		die("fatal: could not malloc() %u bytes\n", n * (sizeof(MenuItem) + SWITCHERLABELLEN));
+	}
+	for (i = 0, m = selmon, first = True; m; m = first ? mons : m->next, first = False) {
+		if (m == selmon && !first) continue;
+		for (c = m->stack; c; c = c->snext, i++) {
+			snprintf(labels + i * SWITCHERLABELLEN, SWITCHERLABELLEN, "%s  [%s]", c->name, c->class);
+			items[i].text = labels + i * SWITCHERLABELLEN;
+			items[i].data = c;
 		}
-		setsid();
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		fprintf(stderr, "wasdwm: execvp %s", ((char **)arg->v)[0]);
-		perror(" failed");
-		exit(EXIT_SUCCESS);
 	}
+	menu_open(items, n, labels, switcher_select);
 }
 
 /**
- * Command: Applies a tag(set) to the selected client.
+ * Command: Applies a tag to the selected client. The client becomes the selection remembered for that tag,
+ * so viewing the tag next focuses it (see get_tag_selection).
  * 
- * @param	arg	arg->ui contains the tagset to apply.
+ * @param	arg	arg->i contains the index of the tag to apply, or ALLTAGS.
  */
 void
 cmd_tag_client (const Arg *arg) {
-	if (selmon->sel && arg->ui & TAGMASK) {
-		selmon->sel->tags = arg->ui & TAGMASK;
-		focus(NULL);
-		arrange(selmon);
+	if (!selmon->sel) return;
+	if (arg->i == ALLTAGS) {
+		selmon->sel->tags = tagmask;
+	} else if (arg->i >= 0 && arg->i < MAXTAGS && TAGSET_HAS(tagmask, arg->i)) {
+		memset(&selmon->sel->tags, 0, sizeof selmon->sel->tags);
+		TAGSET_ADD(selmon->sel->tags, arg->i);
+		get_tag_state(selmon, arg->i + 1)->sel = selmon->sel;
+	} else {
+		return;
 	}
+	focus(NULL);
+	arrange(selmon);
 }
 
 /**
@@ -941,6 +1490,7 @@ cmd_toggle_floating (const Arg *arg) {
 	} else {
 		selmon->sel->bw = borderpx;
 	}
+	snap_index_update(selmon->sel);
 	arrange(selmon);
 }
 
@@ -1000,17 +1550,53 @@ cmd_toggle_mark (const Arg *arg) {
 }
 
 /**
- * Command: Toggle a tag(set) on the currently selected client.
+ * Command: Shows a scratchpad on the selected monitor's current tags and focuses it, or hides it again if it is
+ * already shown there. A scratchpad whose window doesn't exist yet is spawned and shown once it appears.
+ * 
+ * @param	arg	arg->i is the index of the scratchpad (see config.h).
+ */
+void
+cmd_toggle_scratchpad (const Arg *arg) {
+	Client *c;
+
+	if (arg->i < 0 || arg->i >= LENGTH(scratchpads)) return;
+	if (!(c = scratchpad_client(arg->i))) {
+		scratchshow[arg->i] = True;
+		if (!scratchtime[arg->i] || get_time_ms() - scratchtime[arg->i] > SCRATCHPAD_SPAWN_TIMEOUT) {
+			scratchpad_spawn(arg->i);
+		}
+		return;
+	}
+	if (c->mon == selmon && TAGISVISIBLE(c) && !c->minimized) {
+		memset(&c->tags, 0, sizeof c->tags);
+		focus(NULL);
+		arrange(c->mon);
+		return;
+	}
+	if (c->mon != selmon) {
+		send_client_to_monitor(c, selmon);
+		c->x = selmon->winarea_x + (selmon->winarea_width - WIDTH(c)) / 2;
+		c->y = selmon->winarea_y + (selmon->winarea_height - HEIGHT(c)) / 2;
+	}
+	c->tags = selmon->tagset[selmon->selected_tags];
+	c->minimized = False;
+	focus(c);
+	arrange(selmon);
+}
+
+/**
+ * Command: Toggle a tag on the currently selected client.
  * 
- * @param	arg	arg->ui contains the tagset to toggle.
+ * @param	arg	arg->i contains the index of the tag to toggle.
  */
 void
 cmd_toggle_tag (const Arg *arg) {
-	unsigned int newtags;
+	Tagset newtags;
 
-	if (!selmon->sel) return;
-	newtags = selmon->sel->tags ^ (arg->ui & TAGMASK);
-	if (newtags) {
+	if (!selmon->sel || arg->i < 0 || arg->i >= MAXTAGS || !TAGSET_HAS(tagmask, arg->i)) return;
+	newtags = selmon->sel->tags;
+	newtags.w[arg->i / TAGWORDBITS] ^= TAGBIT(arg->i);
+	if (!tagset_empty(&newtags)) {
 		selmon->sel->tags = newtags;
 		focus(NULL);
 		arrange(selmon);
@@ -1024,87 +1610,72 @@ cmd_toggle_tag (const Arg *arg) {
  */
 void
 cmd_toggle_tagbar (const Arg *arg) {
-	selmon->show_tagbar = selmon->pertag->show_tagbars[selmon->pertag->curtag] = !selmon->show_tagbar;
+	selmon->show_tagbar = get_tag_state(selmon, selmon->pertag->curtag)->show_tagbar = !selmon->show_tagbar;
 	update_bar_positions(selmon);
 	XMoveResizeWindow(dpy, selmon->tagbar_win, selmon->winarea_x, selmon->tagbar_pos, selmon->winarea_width, bh);
 	arrange(selmon);
 }
 
 /**
- * Command: Toggles whether a particular tag(set) is visible - does not interfere with the visibility of other tags.
+ * Command: Toggles whether a particular tag is visible - does not interfere with the visibility of other tags.
  * 
- * @param	arg	arg->ui contains the target tagset.
+ * @param	arg	arg->i contains the index of the target tag.
  */
 void
 cmd_toggle_tag_view (const Arg *arg) {
-	unsigned int newtagset = selmon->tagset[selmon->selected_tags] ^ (arg->ui & TAGMASK);
-	int i;
+	Tagset newtagset = selmon->tagset[selmon->selected_tags];
+	TagState *st;
 
-	if (newtagset) {
-		if (newtagset == ~0) {
+	if (arg->i < 0 || arg->i >= MAXTAGS || !TAGSET_HAS(tagmask, arg->i)) return;
+	newtagset.w[arg->i / TAGWORDBITS] ^= TAGBIT(arg->i);
+	if (!tagset_empty(&newtagset)) {
+		if (tagset_equal(&newtagset, &tagmask)) {
 			selmon->pertag->prevtag = selmon->pertag->curtag;
 			selmon->pertag->curtag = 0;
-		}
-		/* test if the user did not select the same tag */
-		if (!(newtagset & 1 << (selmon->pertag->curtag - 1))) {
+		} else if (!selmon->pertag->curtag || !TAGSET_HAS(newtagset, selmon->pertag->curtag - 1)) {
+			/* the current tag was toggled off */
 			selmon->pertag->prevtag = selmon->pertag->curtag;
-			for (i=0; !(newtagset & 1 << i); i++);
-			selmon->pertag->curtag = i + 1;
+			selmon->pertag->curtag = tagset_first(&newtagset) + 1;
 		}
 		selmon->tagset[selmon->selected_tags] = newtagset;
 
 		/* apply settings for this view */
-		selmon->marked_width = selmon->pertag->marked_widths[selmon->pertag->curtag];
-		selmon->selected_layout = selmon->pertag->selected_layouts[selmon->pertag->curtag];
-		selmon->layout[selmon->selected_layout] = selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout];
-		selmon->layout[selmon->selected_layout^1] = selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout^1];
-		if (selmon->show_tagbar != selmon->pertag->show_tagbars[selmon->pertag->curtag]) {
+		st = get_tag_state(selmon, selmon->pertag->curtag);
+		selmon->marked_width = st->marked_width;
+		selmon->selected_layout = st->selected_layout;
+		selmon->layout[selmon->selected_layout] = st->layoutidxs[selmon->selected_layout];
+		selmon->layout[selmon->selected_layout^1] = st->layoutidxs[selmon->selected_layout^1];
+		if (selmon->show_tagbar != st->show_tagbar) {
 			cmd_toggle_tagbar(NULL);
 		}
-		focus(NULL);
+		focus(get_tag_selection(selmon));
 		arrange(selmon);
 	}
 }
 
 /**
- * Command: Views a particular tag(set).
+ * Command: Views a particular tag.
  * 
- * @param	arg	arg->ui holds the tagset to view.
+ * @param	arg	arg->i holds the index of the tag to view, ALLTAGS or PREVTAGS.
  */
 void
 cmd_view_tag (const Arg *arg) {
-	int i;
-	unsigned int tmptag;
+	Tagset ts;
 
-	if ((arg->ui & TAGMASK) && (arg->ui & TAGMASK) != selmon->tagset[selmon->selected_tags]) {
-		selmon->selected_tags ^= 1; /* toggle sel tagset */
-		selmon->pertag->prevtag = selmon->pertag->curtag;
-		selmon->tagset[selmon->selected_tags] = arg->ui & TAGMASK;
-		if (arg->ui == ~0) {
-			selmon->pertag->curtag = 0;
-		} else {
-			for (i=0; !(arg->ui & 1 << i); i++);
-			selmon->pertag->curtag = i + 1;
-		}
-	} else if (view_tag_toggles) {
-		selmon->selected_tags ^= 1; /* toggle sel tagset */
-		tmptag = selmon->pertag->prevtag;
-		selmon->pertag->prevtag = selmon->pertag->curtag;
-		selmon->pertag->curtag = tmptag;
-	}
-	selmon->marked_width = selmon->pertag->marked_widths[selmon->pertag->curtag];
-	selmon->selected_layout = selmon->pertag->selected_layouts[selmon->pertag->curtag];
-	selmon->layout[selmon->selected_layout] = selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout];
-	selmon->layout[selmon->selected_layout^1] = selmon->pertag->layoutidxs[selmon->pertag->curtag][selmon->selected_layout^1];
-	if (selmon->show_tagbar != selmon->pertag->show_tagbars[selmon->pertag->curtag]) {
-		cmd_toggle_tagbar(NULL);
+	if (arg->i == PREVTAGS) {
+		view_tagset(NULL);
+	} else if (arg->i == ALLTAGS) {
+		view_tagset(&tagmask);
+	} else if (arg->i >= 0 && arg->i < MAXTAGS && TAGSET_HAS(tagmask, arg->i)) {
+		memset(&ts, 0, sizeof ts);
+		TAGSET_ADD(ts, arg->i);
+		view_tagset(&ts);
 	}
-	focus(NULL);
-	arrange(selmon);
 }
 
 /**
  * Creates and initializes a new Color structure.
+ * On TrueColor visuals, colors given as "#rrggbb" are converted locally instead of asking the X server.
  * 
  * @param	drw	The relevant Gfx structure.
  * @param	clrname	The name of the color.
@@ -1114,6 +1685,9 @@ color_create (Graphics *drw, const char *clrname) {
 	Color *clr;
 	Colormap cmap;
 	XColor color;
+	Visual *visual;
+	char *end;
+	unsigned long rgb;
 
 	if (!drw) {
 		return NULL;
@@ -1122,6 +1696,14 @@ color_create (Graphics *drw, const char *clrname) {
 	if (!clr) {
 		return NULL;
 	}
+	visual = DefaultVisual(drw->dpy, drw->screen);
+	if (visual->class == TrueColor && clrname[0] == '#' && strlen(clrname) == 7) {
+		rgb = strtoul(clrname + 1, &end, 16);
+		if (*end == '\0') {
+			clr->rgb = color_rgb_to_pixel(visual, rgb);
+			return clr;
+		}
+	}
 	cmap = DefaultColormap(drw->dpy, drw->screen);
 	if (!XAllocNamedColor(drw->dpy, cmap, clrname, &color, &color)) {
 		die("error, cannot allocate color '%s'\n", clrname);
@@ -1142,6 +1724,27 @@ color_free (Color *clr) {
 	}
 }
 
+/**
+ * Converts a 0xrrggbb color value to a pixel value for a TrueColor visual.
+ * 
+ * @param	visual	The target visual.
+ * @param	rgb		The color.
+ */
+unsigned long
+color_rgb_to_pixel (Visual *visual, unsigned long rgb) {
+	unsigned long masks[] = { visual->red_mask, visual->green_mask, visual->blue_mask };
+	unsigned long pixel = 0, mask, v;
+	int i, shift;
+
+	for (i = 0; i < 3; i++) {
+		mask = masks[i];
+		v = (rgb >> (16 - 8 * i)) & 0xff;
+		for (shift = 0; mask && !(mask & 1); shift++, mask >>= 1);
+		pixel |= ((v * mask + 127) / 255) << shift;
+	}
+	return pixel;
+}
+
 /**
  * Updates the geometry of the window associated with a given client.
  * 
@@ -1174,6 +1777,7 @@ void
 detach (Client *c) {
 	Client **tc;
 
+	c->mon->version++;
 	for (tc = &c->mon->clients; *tc && *tc != c; tc = &(*tc)->next);
 	*tc = c->next;
 }
@@ -1193,6 +1797,103 @@ die (const char *errstr, ...) {
 	exit(EXIT_FAILURE);
 }
 
+/**
+ * Inserts an edge into an edge index, keeping the index sorted.
+ * 
+ * @param	idx	The target index.
+ * @param	pos	The coordinate of the edge.
+ * @param	lo	The start of the edge along the other axis.
+ * @param	hi	The end of the edge along the other axis.
+ * @param	c	The client the edge belongs to.
+ */
+void
+edge_index_insert (EdgeIndex *idx, int pos, int lo, int hi, Client *c) {
+	int i;
+
+	if (idx->n == idx->size) {
+		idx->size = idx->size ? idx->size * 2 : 32;
+		if (!(idx->edges = realloc(idx->edges, idx->size * sizeof(Edge)))) {
+			die("fatal: could not malloc() %u bytes\n", idx->size * sizeof(Edge));
+		}
+	}
+	i = get_lower_bound(idx->edges, idx->n, sizeof(Edge), pos);
+	memmove(&idx->edges[i + 1], &idx->edges[i], (idx->n - i) * sizeof(Edge));
+	idx->edges[i].pos = pos;
+	idx->edges[i].lo = lo;
+	idx->edges[i].hi = hi;
+	idx->edges[i].c = c;
+	idx->n++;
+}
+
+/**
+ * Finds the edge of a visible client closest to a given coordinate, within the snap distance.
+ * Only edges that overlap the range [lo, hi) along the other axis are considered.
+ * Returns the offset from pos to the edge (0 if pos is already aligned with one), or INT_MAX if there is none.
+ * 
+ * @param	idx	The index to search.
+ * @param	pos	The coordinate to snap.
+ * @param	lo	The start of the range along the other axis.
+ * @param	hi	The end of the range along the other axis.
+ * @param	skip	A client whose edges are ignored (usually the one being moved).
+ */
+int
+edge_index_nearest (EdgeIndex *idx, int pos, int lo, int hi, Client *skip) {
+	int i, best = INT_MAX, dist = snap;
+	Edge *e;
+
+	for (i = get_lower_bound(idx->edges, idx->n, sizeof(Edge), pos - snap + 1); i < idx->n && idx->edges[i].pos < pos + (int)snap; i++) {
+		e = &idx->edges[i];
+		if (e->c == skip || e->hi <= lo || e->lo >= hi || !TAGISVISIBLE(e->c) || e->c->minimized) continue;
+		if (abs(e->pos - pos) < dist) {
+			dist = abs(e->pos - pos);
+			best = e->pos - pos;
+		}
+	}
+	return best;
+}
+
+/**
+ * Removes the edge of a given client at a given coordinate from an edge index.
+ * 
+ * @param	idx	The target index.
+ * @param	pos	The coordinate of the edge.
+ * @param	c	The client the edge belongs to.
+ */
+void
+edge_index_remove (EdgeIndex *idx, int pos, Client *c) {
+	int i;
+
+	for (i = get_lower_bound(idx->edges, idx->n, sizeof(Edge), pos); i < idx->n && idx->edges[i].pos == pos; i++) {
+		if (idx->edges[i].c == c) {
+			memmove(&idx->edges[i], &idx->edges[i + 1], (idx->n - i - 1) * sizeof(Edge));
+			idx->n--;
+			return;
+		}
+	}
+}
+
+/**
+ * Reads all events that are waiting on the X connection and handles queued user input (key presses, button presses
+ * and pointer crossings) ahead of everything else, so shortcuts stay responsive while clients flood the queue.
+ * Input on a window is never handled ahead of a queued map, unmap or destroy event for that window, and a button press
+ * never ahead of a queued button release (the mouse commands wait for the release of their own press).
+ */
+void
+dispatch_priority_events (void) {
+	XEvent ev;
+	PriorityScan scan;
+
+	XEventsQueued(dpy, QueuedAfterReading);
+	for (;;) {
+		scan.nbusy = 0;
+		scan.released = False;
+		if (!XCheckIfEvent(dpy, &ev, _priority_event, (XPointer)&scan)) break;
+		if (handler[ev.type]) {
+			handler[ev.type](&ev);
+		}
+	}
+}
+
 /**
  * Returns the next or previous monitor in the monitor list (interpreted as a cycle), depending on the sign of the argument.
  * 
@@ -1200,18 +1901,7 @@ die (const char *errstr, ...) {
  */
 Monitor *
 direction_to_monitor (int dir) {
-	Monitor *m = NULL;
-
-	if (dir > 0) {
-		if (!(m = selmon->next)) {
-			m = mons;
-		}
-	} else if (selmon == mons) {
-		for (m = mons; m->next; m = m->next);
-	} else {
-		for (m = mons; m->next != selmon; m = m->next);
-	}
-	return m;
+	return monindex.mons[(selmon->num + (dir > 0 ? 1 : monindex.n - 1)) % monindex.n];
 }
 
 /**
@@ -1245,11 +1935,15 @@ draw_clientbar (Monitor *m) {
 	view_info_w = blw = TEXTW(m->layout_symbol);
 	tot_width = view_info_w;
 
+	if (batching) {
+		m->deferred |= DeferDraw;
+		return;
+	}
 	/* Calculates number of labels and their width */
 	m->num_client_tabs = 0;
 	for (c = m->clients; c && m->num_client_tabs < MAXTABS; c = c->next) {
 		if (!TAGISVISIBLE(c)) continue;
-		m->client_tab_widths[m->num_client_tabs] = TEXTW(c->name);
+		m->client_tab_widths[m->num_client_tabs] = TEXTW(get_client_label(c)) + ICONW(c);
 		tot_width += m->client_tab_widths[m->num_client_tabs];
 	
 		m->num_client_tabs++;
@@ -1286,7 +1980,7 @@ draw_clientbar (Monitor *m) {
 		} else {
 			gfx_set_colorscheme(drw, &scheme[SchemeNorm]);
 		}
-		gfx_draw_text(drw, x, 0, w, th, c->name);
+		gfx_draw_icon_text(drw, x, 0, w, th, get_client_icon(c), get_client_label(c));
 		if (c->marked) {
 			gfx_draw_rect(drw, x, 0, w, th, (c == selmon->sel), True);
 		}
@@ -1317,28 +2011,34 @@ draw_clientbar (Monitor *m) {
 void
 draw_tagbar (Monitor *m) {
 	int x, xx, w;
-	unsigned int i, occ = 0, urg = 0;
+	unsigned int i;
+	Tagset occ = {{0}}, urg = {{0}};
 	Client *c;
 
+	if (batching) {
+		m->deferred |= DeferDraw;
+		return;
+	}
 	for (c = m->clients; c; c = c->next) {
-		occ |= c->tags;
+		tagset_or(&occ, &c->tags);
 		if (c->isurgent) {
-			urg |= c->tags;
+			tagset_or(&urg, &c->tags);
 		}
 	}
 	x = 0;
-	for (i = 0; i < LENGTH(tags); i++) {
-		if (!hide_inactive_tags || occ & 1 << i || m->tagset[m->selected_tags] & 1 << i) {
-			w = TEXTW(tags[i]);
-			if (urg & 1 << i) {
+	for (i = 0; i < numtags; i++) {
+		if (!TAGSET_HAS(tagmask, i)) continue;
+		if (!hide_inactive_tags || TAGSET_HAS(occ, i) || TAGSET_HAS(m->tagset[m->selected_tags], i)) {
+			w = TEXTW(tagnames[i]);
+			if (TAGSET_HAS(urg, i)) {
 				gfx_set_colorscheme(drw, &scheme[SchemeUrgent]);
-			} else if (m->tagset[m->selected_tags] & 1 << i) {
-				gfx_set_colorscheme(drw, (m == selmon && selmon->sel && selmon->sel->tags & 1 << i) ? &scheme[SchemeSel] : &scheme[SchemeVisible]);
+			} else if (TAGSET_HAS(m->tagset[m->selected_tags], i)) {
+				gfx_set_colorscheme(drw, (m == selmon && selmon->sel && TAGSET_HAS(selmon->sel->tags, i)) ? &scheme[SchemeSel] : &scheme[SchemeVisible]);
 			} else {
 				gfx_set_colorscheme(drw, &scheme[SchemeNorm]);
 			}
-			gfx_draw_text(drw, x, 0, w, bh, tags[i]);
-			gfx_draw_rect(drw, x, 0, w, bh, m == selmon && selmon->sel && selmon->sel->tags & 1 << i, occ & 1 << i);
+			gfx_draw_text(drw, x, 0, w, bh, tagnames[i]);
+			gfx_draw_rect(drw, x, 0, w, bh, m == selmon && selmon->sel && TAGSET_HAS(selmon->sel->tags, i), TAGSET_HAS(occ, i) != 0);
 			x += w;
 		}
 	}
@@ -1355,7 +2055,7 @@ draw_tagbar (Monitor *m) {
 		x = xx;
 		if (m->sel) {
 			gfx_set_colorscheme(drw, m == selmon ? &scheme[SchemeSel] : &scheme[SchemeNorm]);
-			gfx_draw_text(drw, x, 0, w, bh, m->sel->name);
+			gfx_draw_icon_text(drw, x, 0, w, bh, get_client_icon(m->sel), m->sel->name);
 			gfx_draw_rect(drw, x, 0, w, bh, m->sel->isfixed, m->sel->isfloating);
 		} else {
 			gfx_set_colorscheme(drw, &scheme[SchemeNorm]);
@@ -1373,7 +2073,9 @@ draw_tagbar (Monitor *m) {
  */
 void
 event_button_press (XEvent *e) {
-	unsigned int i, x, click, occ = 0;
+	unsigned int i, x, click;
+	int tabx, tab;
+	Tagset occ = {{0}};
 	Arg arg = {0};
 	Client *c;
 	Monitor *m;
@@ -1389,17 +2091,18 @@ event_button_press (XEvent *e) {
 	}
 	if (ev->window == selmon->tagbar_win) {
 		for (c = m->clients; c; c = c->next) {
-			occ |= c->tags;
+			tagset_or(&occ, &c->tags);
 		}
-		i = x = 0;
-		do {
-			if (!hide_inactive_tags || occ & 1 << i || m->tagset[m->selected_tags] & 1 << i) {
-				x += TEXTW(tags[i]);
+		for (i = x = 0; i < numtags; i++) {
+			if (TAGSET_HAS(tagmask, i)
+					&& (!hide_inactive_tags || TAGSET_HAS(occ, i) || TAGSET_HAS(m->tagset[m->selected_tags], i))
+					&& ev->x < (x += TEXTW(tagnames[i]))) {
+				break;
 			}
-		} while (ev->x >= x && ++i < LENGTH(tags));
-		if (i < LENGTH(tags)) {
+		}
+		if (i < numtags) {
 			click = ClickTagBar;
-			arg.ui = 1 << i;
+			arg.i = i;
 		} else if (ev->x > selmon->winarea_width - TEXTW(stext)) {
 			click = ClickStatusText;
 		} else {
@@ -1407,24 +2110,12 @@ event_button_press (XEvent *e) {
 		}
 	}
 	if (ev->window == selmon->clientbar_win) {
+		preview_close();
 		if (ev->x > selmon->winarea_width - TEXTW(m->layout_symbol)) {
 			click = ClickLayoutSymbol;
-		} else {
-			i = 0; x = 0;
-			for (c = selmon->clients; c; c = c->next) {
-				if (!TAGISVISIBLE(c)) continue;
-				x += selmon->client_tab_widths[i];
-				if (ev->x > x) {
-					i++;
-				} else {
-					break;
-				}
-				if (i >= m->num_client_tabs) break;
-			}
-			if (c) {
-				click = ClickClientBar;
-				arg.ui = i;
-			}
+		} else if (get_client_tab(selmon, ev->x, &tabx, &tab)) {
+			click = ClickClientBar;
+			arg.ui = tab;
 		}
 	} else if ((c = window_to_client(ev->window))) {
 		focus(c);
@@ -1435,7 +2126,7 @@ event_button_press (XEvent *e) {
 				&& CLEANMASK(buttons[i].mask) == CLEANMASK(ev->state)) {
 					
 			buttons[i].func(((click == ClickTagBar || click == ClickClientBar)
-					&& buttons[i].arg.i == 0) ? &arg : &buttons[i].arg);
+					&& buttons[i].arg.i == CLICKEDTAG) ? &arg : &buttons[i].arg);
 		}
 	}
 }
@@ -1475,44 +2166,71 @@ event_client_message (XEvent *e) {
  */
 void
 event_configure_notify (XEvent *e) {
-	Monitor *m;
 	XConfigureEvent *ev = &e->xconfigure;
-	Bool dirty;
 
-	/* TODO: update_geometry handling sucks, needs to be simplified */
 	if (ev->window == root) {
-		dirty = (sw != ev->width || sh != ev->height);
 		sw = ev->width;
 		sh = ev->height;
-		if (update_geometry() || dirty) {
-			gfx_resize(drw, sw, bh);
-			init_bars();
-			/* refreshes display of tag bar. The client bar is handled by arrange(), which is called below */
-			for (m = mons; m; m = m->next) {
-				XMoveResizeWindow(dpy, m->tagbar_win, m->winarea_x, m->tagbar_pos, m->winarea_width, bh);
-			}
-			focus(NULL);
-			arrange(NULL);
+		if (!screentimer.armed) {
+			timer_arm(&screentimer, 0);
 		}
 	}
 }
 
 /**
  * Handler for ConfigureRequest events.
+ * Requests for the same window that are already queued are merged into this one (later values win), so a client
+ * flooding the queue is configured once per batch of events rather than once per request.
  * 
  * @param	e	The event.
  */
 void
 event_configure_request (XEvent *e) {
+	unsigned int merged = 0;
 	Client *c;
 	Monitor *m;
 	XConfigureRequestEvent *ev = &e->xconfigurerequest;
 	XWindowChanges wc;
+	XEvent next;
+	EventScan scan = { ev->window, False };
+
+	while (XCheckIfEvent(dpy, &next, _pending_configure_request, (XPointer)&scan)) {
+		if (next.xconfigurerequest.value_mask & CWX) {
+			ev->x = next.xconfigurerequest.x;
+		}
+		if (next.xconfigurerequest.value_mask & CWY) {
+			ev->y = next.xconfigurerequest.y;
+		}
+		if (next.xconfigurerequest.value_mask & CWWidth) {
+			ev->width = next.xconfigurerequest.width;
+		}
+		if (next.xconfigurerequest.value_mask & CWHeight) {
+			ev->height = next.xconfigurerequest.height;
+		}
+		if (next.xconfigurerequest.value_mask & CWBorderWidth) {
+			ev->border_width = next.xconfigurerequest.border_width;
+		}
+		if (next.xconfigurerequest.value_mask & CWSibling) {
+			ev->above = next.xconfigurerequest.above;
+		}
+		if (next.xconfigurerequest.value_mask & CWStackMode) {
+			ev->detail = next.xconfigurerequest.detail;
+		}
+		ev->value_mask |= next.xconfigurerequest.value_mask;
+		merged++;
+		scan.blocked = False;
+	}
 
 	if ((c = window_to_client(ev->window))) {
+		c->cfgreqs += merged + 1;
+		c->cfgapplied++;
+		rate_add(&c->cfgrate, merged + 1);
+		schedule_stats_update();
 		if (ev->value_mask & CWBorderWidth) {
 			c->bw = ev->border_width;
-		} else if (c->isfloating || !selmon->layout[selmon->selected_layout]->arrange) {
+		}
+		/* a request for nothing but the border width needs no geometry change */
+		if ((ev->value_mask & ~CWBorderWidth) && (c->isfloating || !selmon->layout[selmon->selected_layout]->arrange)) {
 			m = c->mon;
 			if (ev->value_mask & CWX) {
 				c->oldx = c->x;
@@ -1541,8 +2259,10 @@ event_configure_request (XEvent *e) {
 			}
 			if (TAGISVISIBLE(c)) {
 				XMoveResizeWindow(dpy, c->win, c->x, c->y, c->w, c->h);
+				c->shown = True;
 			}
-		} else {
+			snap_index_update(c);
+		} else if (ev->value_mask & ~CWBorderWidth) {
 			configure(c);
 		}
 	} else {
@@ -1611,7 +2331,11 @@ event_expose (XEvent *e) {
 	Monitor *m;
 	XExposeEvent *ev = &e->xexpose;
 
-	if (ev->count == 0 && (m = window_to_monitor(ev->window))) {
+	if (ev->count == 0 && menu.win && ev->window == menu.win) {
+		menu_draw();
+	} else if (ev->count == 0 && preview.win && ev->window == preview.win && preview.c->thumb) {
+		XCopyArea(dpy, preview.c->thumb, preview.win, drw->gc, 0, 0, preview.c->thumbw, preview.c->thumbh, 0, 0);
+	} else if (ev->count == 0 && (m = window_to_monitor(ev->window))) {
 		draw_tagbar(m);
 		draw_clientbar(m);
 	}
@@ -1634,7 +2358,8 @@ event_focus_in (XEvent *e) {
 
 /**
  * Handler for KeyPress events.
- * Called when the user presses a key combination that the WM has grabbed.
+ * Called when the user presses a key combination that the WM has grabbed, or any key while a key sequence
+ * is being typed (see chord_press).
  * 
  * @param	e	The event.
  */
@@ -1645,7 +2370,9 @@ event_key_press (XEvent *e) {
 	XKeyEvent *ev;
 
 	ev = &e->xkey;
+	if (menu_key(ev)) return;
 	keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
+	if (chord_press(ev, keysym)) return;
 	for (i = 0; i < LENGTH(keys); i++) {
 		if (keysym == keys[i].keysym
 				&& CLEANMASK(keys[i].mod) == CLEANMASK(ev->state)
@@ -1655,6 +2382,19 @@ event_key_press (XEvent *e) {
 	}
 }
 
+/**
+ * Handler for LeaveNotify events.
+ * Closes the preview when the pointer leaves a client bar (see event_motion_notify).
+ * 
+ * @param	e	The event.
+ */
+void
+event_leave_notify (XEvent *e) {
+	if (preview.c && window_to_monitor(e->xcrossing.window) == preview.mon) {
+		preview_close();
+	}
+}
+
 /**
  * Handler for MappingNotify events.
  * Called for changes in the keyboard/pointer mapping.
@@ -1690,42 +2430,55 @@ event_map_request (XEvent *e) {
 }
 
 /**
- * Handler for MotionNotify events.
- * Called when the pointer is moved.
+ * Handler for MotionNotify events, which are only selected on the client bars (if show_previews is set).
+ * Hovering the tab of a hidden client shows a preview of it after preview_delay milliseconds, or right away if
+ * another preview is already shown.
  * 
  * @param	e	The event.
  */
 void
 event_motion_notify (XEvent *e) {
-	static Monitor *mon = NULL;
+	int x, tab;
+	Client *c;
 	Monitor *m;
 	XMotionEvent *ev = &e->xmotion;
 
-	if (ev->window != root)	return;
-	
-	if ((m = rect_to_monitor(ev->x_root, ev->y_root, 1, 1)) != mon && mon) {
-		unfocus(selmon->sel);
-		focus_root();
-		selmon = m;
-		focus(NULL);
+	if (!(m = window_to_monitor(ev->window)) || ev->window != m->clientbar_win) return;
+	if (!(c = get_client_tab(m, ev->x, &x, &tab)) || c->shown) {
+		preview_close();
+	} else if (c != preview.c) {
+		if (preview.c) {
+			preview_unredirect(preview.c);
+		}
+		preview.c = c;
+		preview.mon = m;
+		preview.x = x;
+		/* a window that was just redirected needs time to paint into its new pixmap before it is captured */
+		timer_arm(&previewtimer, preview_redirect(c) || !preview.win ? preview_delay : 0);
 	}
-	mon = m;
 }
 
 /**
  * Handler for PropertyNotify events.
- * Called when windows change their properties.
+ * Called when windows change their properties. Also runs the commands written to the _WASDWM_COMMAND property
+ * of the root window (see run_command_string), e.g. with xprop -root -f _WASDWM_COMMAND 8s -set _WASDWM_COMMAND "view_tag 3".
  * 
  * @param	e	The event.
  */
 void
 event_property_notify (XEvent *e) {
+	char cmds[1024];
 	Client *c;
 	Window trans;
 	XPropertyEvent *ev = &e->xproperty;
 
 	if ((ev->window == root) && (ev->atom == XA_WM_NAME)) {
 		update_statusarea();
+	} else if (ev->window == root && ev->atom == wasdwmatom[WasdwmCommand] && ev->state == PropertyNewValue) {
+		if (get_prop_text(root, ev->atom, cmds, sizeof cmds)) {
+			XDeleteProperty(dpy, root, ev->atom);
+			run_command_string(cmds);
+		}
 	} else if (ev->state == PropertyDelete) {
 		return; /* ignore */
 	} else if ((c = window_to_client(ev->window))) {
@@ -1734,8 +2487,10 @@ event_property_notify (XEvent *e) {
 				break;
 			case XA_WM_TRANSIENT_FOR:
 				if (!c->isfloating && (XGetTransientForHint(dpy, c->win, &trans)) &&
-				   (c->isfloating = (window_to_client(trans)) != NULL))
+				   (c->isfloating = (window_to_client(trans)) != NULL)) {
+					snap_index_update(c);
 					arrange(c->mon);
+				}
 				break;
 			case XA_WM_NORMAL_HINTS:
 				update_size_hints(c);
@@ -1746,18 +2501,35 @@ event_property_notify (XEvent *e) {
 				break;
 		}
 		if (ev->atom == XA_WM_NAME || ev->atom == netatom[NetWMName]) {
-			update_title(c);
-			if (c == c->mon->sel) {
-				draw_tagbar(c->mon);
-			}
-			draw_clientbar(c->mon);
+			schedule_title_update(c);
 		}
 		if (ev->atom == netatom[NetWMWindowType]) {
 			update_window_type(c);
+			snap_index_update(c);
+		}
+		if (ev->atom == netatom[NetWMIcon]) {
+			update_icon(c);
+			draw_bars();
 		}
 	}
 }
 
+#ifdef XRANDR
+/**
+ * Handler for RandR screen and output change events.
+ * A single hotplug produces a burst of these, so the monitors are only updated once the queued events have been handled.
+ * 
+ * @param	e	The event.
+ */
+void
+event_randr_notify (XEvent *e) {
+	XRRUpdateConfiguration(e);
+	if (!screentimer.armed) {
+		timer_arm(&screentimer, 0);
+	}
+}
+#endif /* XRANDR */
+
 /**
  * Handler for UnmapNotify events.
  * Called when a window is unmapped.
@@ -1778,6 +2550,39 @@ event_unmap_notify (XEvent *e) {
 	}
 }
 
+/**
+ * Moves all clients of a monitor to another monitor, keeping their tags.
+ * Each client remembers where it came from, so it can be moved back if the monitor returns (see update_geometry_randr).
+ * 
+ * @param	m	The monitor to empty.
+ * @param	target	The monitor that receives the clients.
+ */
+void
+evacuate_monitor (Monitor *m, Monitor *target) {
+	Client *c;
+	int i;
+
+	while ((c = m->clients)) {
+		m->clients = c->next;
+		stack_detach(c);
+		if (m->name) {
+			c->homemon = m->name;
+		}
+		c->mon = target;
+		attach(c);
+		stack_attach(c);
+		snap_index_update(c);
+	}
+	m->sel = NULL;
+	for (i = 0; i <= MAXTAGS; i++) {
+		if (m->pertag->tags[i]) {
+			m->pertag->tags[i]->sel = NULL;
+		}
+	}
+	m->version++;
+	target->dirty = True;
+}
+
 /**
  * Gives focus to a given client.  If NULL is passed as an argument, tries to focus on the first visible client in the selected monitor's stack; focus is lost if that fails.
  * 
@@ -1813,6 +2618,9 @@ focus (Client *c) {
 		focus_root();
 	}
 	selmon->sel = c;
+	if (c) {
+		get_tag_state(selmon, selmon->pertag->curtag)->sel = c;
+	}
 	draw_bars();
 	arrange(selmon);
 }
@@ -1932,6 +2740,158 @@ font_get_text_width (FontStruct *font, const char *text, unsigned int len) {
 	return tex.w;
 }
 
+/**
+ * Returns True if the characters of a query appear in a text in the same order, ignoring case.
+ * 
+ * @param	query	The search string.
+ * @param	text	The text to search.
+ */
+Bool
+fuzzy_match (const char *query, const char *text) {
+	for (; *query && *text; text++) {
+		if (tolower((unsigned char)*query) == tolower((unsigned char)*text)) {
+			query++;
+		}
+	}
+	return !*query;
+}
+
+/**
+ * Returns a client's icon for drawing it in a bar, or NULL if it has none. Clients restored after a restart get
+ * their icon the first time they are drawn, so those on hidden tags don't cost a round trip each.
+ * 
+ * @param	c	The target client.
+ */
+Icon *
+get_client_icon (Client *c) {
+	if (!c->iconloaded) {
+		update_icon(c);
+	}
+	return c->icon;
+}
+
+/**
+ * Returns the text of a client's tab in the client bar: its title, followed by its memory use if
+ * show_client_resources is set and it has been sampled. The result is overwritten by the next call.
+ * 
+ * @param	c	The target client.
+ */
+const char *
+get_client_label (Client *c) {
+	static char label[sizeof c->name + 48];
+
+	if (!show_client_resources || (!c->rss && !c->pixmapbytes)) {
+		return c->name;
+	}
+	snprintf(label, sizeof label, "%s [X %luM, RSS %luM]", c->name, c->pixmapbytes >> 20, c->rss >> 10);
+	return label;
+}
+
+/**
+ * Gets the process owning a client window from _NET_WM_PID. Windows of remote clients (with a WM_CLIENT_MACHINE
+ * other than this host) don't count, their process ids mean nothing here.
+ * 
+ * @param	c	The target client.
+ */
+pid_t
+get_client_pid (Client *c) {
+	int di;
+	unsigned long n, dl;
+	unsigned char *p = NULL;
+	char host[256];
+	long pid = 0;
+	Atom da;
+	XTextProperty machine;
+
+	if (XGetWindowProperty(dpy, c->win, netatom[NetWMPid], 0L, 1L, False, XA_CARDINAL,
+						   &da, &di, &n, &dl, &p) == Success && p) {
+		if (n) {
+			pid = *(long *)p; /* format 32 properties are returned as longs */
+		}
+		XFree(p);
+	}
+	if (pid > 0 && XGetWMClientMachine(dpy, c->win, &machine)) {
+		if (machine.value && !gethostname(host, sizeof host)
+				&& strncmp((char *)machine.value, host, sizeof host)) {
+			pid = 0;
+		}
+		XFree(machine.value);
+	}
+	return pid > 0 ? pid : 0;
+}
+
+/**
+ * Returns the client whose client bar tab is at a position (as drawn by draw_clientbar), or NULL.
+ * 
+ * @param	m		The monitor of the client bar.
+ * @param	x		The position, relative to the client bar.
+ * @param	tabx	Set to the left edge of the tab.
+ * @param	tab		Set to the index of the tab, counting the visible clients (see cmd_focus_client).
+ */
+Client *
+get_client_tab (Monitor *m, int x, int *tabx, int *tab) {
+	Client *c;
+
+	*tabx = *tab = 0;
+	for (c = m->clients; c && *tab < m->num_client_tabs; c = c->next) {
+		if (!TAGISVISIBLE(c)) continue;
+		if (x < *tabx + m->client_tab_widths[*tab]) {
+			return c;
+		}
+		*tabx += m->client_tab_widths[(*tab)++];
+	}
+	return NULL;
+}
+
+/**
+ * Returns the index of the first element of a sorted array that isn't less than a given value.
+ * The elements are compared by an int key at their start, so this works on plain int arrays and on arrays of
+ * structures such as Edges alike.
+ * 
+ * @param	a	The sorted array.
+ * @param	n	The length of a.
+ * @param	size	The size of an element of a.
+ * @param	v	The value to look for.
+ */
+int
+get_lower_bound (const void *a, int n, size_t size, int v) {
+	int lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (*(const int *)((const char *)a + mid * size) < v) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * Returns the resident memory of a process in KiB, or 0 if it isn't known (it is read from /proc on Linux).
+ * 
+ * @param	pid	The target process.
+ */
+unsigned long
+get_process_rss (pid_t pid) {
+	unsigned long rss = 0;
+#ifdef __linux__
+	char path[64];
+	FILE *f;
+
+	snprintf(path, sizeof path, "/proc/%ld/statm", (long)pid);
+	if ((f = fopen(path, "r"))) {
+		if (fscanf(f, "%*u %lu", &rss) != 1) {
+			rss = 0;
+		}
+		fclose(f);
+	}
+	rss *= sysconf(_SC_PAGESIZE) / 1024;
+#endif /* __linux__ */
+	return rss;
+}
+
 /**
  * Gets a property of a client window from the X server (as an Atom).
  * 
@@ -2028,6 +2988,53 @@ get_state (Window w) {
 	return result;
 }
 
+/**
+ * Returns the client that was last selected on a monitor's current tag, or NULL if it isn't
+ * visible anymore (focus() then falls back to the focus stack).
+ * 
+ * @param	m	The target monitor.
+ */
+Client *
+get_tag_selection (Monitor *m) {
+	TagState *st = m->pertag->tags[m->pertag->curtag];
+	Client *c = st ? st->sel : NULL;
+
+	return c && TAGISVISIBLE(c) && !c->minimized ? c : NULL;
+}
+
+/**
+ * Returns the state of a tag on a monitor, allocating it with the configured defaults when the tag is first used.
+ * 
+ * @param	m		The target monitor.
+ * @param	curtag	The tag, indexed like Pertag.curtag.
+ */
+TagState *
+get_tag_state (Monitor *m, unsigned int curtag) {
+	TagState *st;
+
+	if ((st = m->pertag->tags[curtag])) return st;
+	if (!(st = calloc(1, sizeof(TagState)))) {
+		die("fatal: could not malloc() %u bytes\n", sizeof(TagState));
+	}
+	st->marked_width = marked_width;
+	st->selected_layout = 0;
+	st->layoutidxs[0] = &layouts[def_layouts[1] % LENGTH(layouts)];
+	st->layoutidxs[1] = &layouts[1 % LENGTH(layouts)];
+	st->show_tagbar = show_tagbar;
+	return m->pertag->tags[curtag] = st;
+}
+
+/**
+ * Returns the time in milliseconds according to a monotonic clock.
+ */
+long long
+get_time_ms (void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
 /**
  * Returns a new Graphics structure.
  */
@@ -2049,6 +3056,35 @@ gfx_create (Display *dpy, int screen, Window root, unsigned int w, unsigned int
 	return drw;
 }
 
+/**
+ * Renders text like gfx_draw_text, preceded by an icon (see icon_create), which costs a single XCopyArea.
+ * The icon is left out if there is hardly any room.
+ * 
+ * @param	drw		The relevant Graphics structure.
+ * @param	x		Left edge of the area to draw.
+ * @param	y		Top edge of the area to draw.
+ * @param	w		Width of the area.
+ * @param	h		Height of the area.
+ * @param	icon	The icon, or NULL.
+ * @param	text	The text.
+ */
+void
+gfx_draw_icon_text (Graphics *drw, int x, int y, unsigned int w, unsigned int h, Icon *icon, const char *text) {
+	unsigned int iw = icon ? icon->size + h / 2 : 0;
+
+	if (!icon || w < iw + h) {
+		gfx_draw_text(drw, x, y, w, h, text);
+		return;
+	}
+	gfx_draw_text(drw, x, y, iw, h, NULL);
+	gfx_draw_text(drw, x + iw, y, w - iw, h, text);
+	XSetClipMask(drw->dpy, drw->gc, icon->mask);
+	XSetClipOrigin(drw->dpy, drw->gc, x + h / 2, y + (int)(h - icon->size) / 2);
+	XCopyArea(drw->dpy, icon->pixmap, drw->drawable, drw->gc, 0, 0, icon->size, icon->size,
+			  x + h / 2, y + (int)(h - icon->size) / 2);
+	XSetClipMask(drw->dpy, drw->gc, None);
+}
+
 /**
  * Draws a rectangle on the screen.
  * 
@@ -2189,7 +3225,6 @@ grab_buttons (Client *c, Bool focused) {
 	unsigned int i, j;
 	unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
 
-	update_numlock_mask();
 	XUngrabButton(dpy, AnyButton, AnyModifier, c->win);
 	if (focused) {
 		for (i = 0; i < LENGTH(buttons); i++) {
@@ -2216,6 +3251,7 @@ grab_shortcut_keys (void) {
 	unsigned int i, j;
 	unsigned int modifiers[] = { 0, LockMask, numlockmask, numlockmask|LockMask };
 	KeyCode code;
+	KeyNode *n;
 	
 	update_numlock_mask();
 
@@ -2228,35 +3264,219 @@ grab_shortcut_keys (void) {
 			}
 		}
 	}
+	for (n = keytrie; n; n = n->next) { /* the rest of a sequence comes in through a keyboard grab */
+		if ((code = XKeysymToKeycode(dpy, n->key.keysym))) {
+			for (j = 0; j < LENGTH(modifiers); j++) {
+				XGrabKey(dpy, code, n->key.mod | modifiers[j], root,
+					 True, GrabModeAsync, GrabModeAsync);
+			}
+		}
+	}
 }
 
 /**
- * Initializes (or reinitializes) the windows that represent the tag and client bars.
+ * Returns the icon for an ARGB image (in the format of _NET_WM_ICON), scaled to fit iconsize x iconsize and
+ * centered. Clients with identical images share one icon, so it is only scaled and uploaded once: images are
+ * recognized by their size and a 64 bit FNV-1a checksum of their pixels.
+ * Returns NULL if the screen isn't TrueColor.
+ * 
+ * @param	argb	The pixels, one per long (the upper 32 bits of 64 bit longs are unused).
+ * @param	w		The width of the image.
+ * @param	h		The height of the image.
  */
-void
-init_bars (void) {
-	Monitor *m;
-	XSetWindowAttributes wa = {
-		.override_redirect = True,
-		.background_pixmap = ParentRelative,
-		.event_mask = ButtonPressMask|ExposureMask
-	};
-	
-	for (m = mons; m; m = m->next) {
-		if (m->tagbar_win) continue;
-		
-		m->tagbar_win = XCreateWindow(dpy, root, m->winarea_x, m->tagbar_pos, m->winarea_width, bh, 0, DefaultDepth(dpy, screen),
-								  CopyFromParent, DefaultVisual(dpy, screen),
-								  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
-		XDefineCursor(dpy, m->tagbar_win, cursor[CursorNormal]);
-		XMapRaised(dpy, m->tagbar_win);
-		m->clientbar_win = XCreateWindow(dpy, root, m->winarea_x, m->clientbar_pos, m->winarea_width, th, 0, DefaultDepth(dpy, screen),
-					  CopyFromParent, DefaultVisual(dpy, screen),
-					  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
-		XDefineCursor(dpy, m->clientbar_win, cursor[CursorNormal]);
-		XMapRaised(dpy, m->clientbar_win);
+Icon *
+icon_create (const unsigned long *argb, int w, int h) {
+	int x, y, dw, dh, ox, oy, shift[3], bpl = (iconsize + 7) / 8;
+	unsigned long *scaled, mask[3], v;
+	unsigned long long hash = 14695981039346656037ULL;
+	unsigned int i;
+	char *bits;
+	Icon *icon;
+	Visual *vis = DefaultVisual(dpy, screen);
+	XImage *img;
+	GC gc;
+
+	for (i = 0; i < (unsigned int)(w * h); i++) {
+		hash = (hash ^ (argb[i] & 0xffffffff)) * 1099511628211ULL;
+	}
+	for (icon = icons; icon; icon = icon->next) {
+		if (icon->hash == hash && icon->w == w && icon->h == h && icon->size == iconsize) {
+			icon->refs++;
+			return icon;
+		}
 	}
-}
+	if (vis->class != TrueColor) return NULL;
+	mask[0] = vis->red_mask;
+	mask[1] = vis->green_mask;
+	mask[2] = vis->blue_mask;
+	for (i = 0; i < 3; i++) {
+		for (shift[i] = 0; mask[i] && !(mask[i] >> shift[i] & 1); shift[i]++);
+	}
+	/* keep the aspect ratio */
+	dw = w >= h ? iconsize : MAX(1, w * (int)iconsize / h);
+	dh = h >= w ? iconsize : MAX(1, h * (int)iconsize / w);
+	ox = (iconsize - dw) / 2;
+	oy = (iconsize - dh) / 2;
+	if (!(scaled = malloc(dw * dh * sizeof(unsigned long))) || !(bits = calloc(bpl * iconsize, 1))
+			|| !(icon = calloc(1, sizeof(Icon)))) {
+		die("fatal: could not malloc() %u bytes\n", dw * dh * sizeof(unsigned long));
+	}
+	icon_scale(argb, w, h, scaled, dw, dh);
+	img = XCreateImage(dpy, vis, DefaultDepth(dpy, screen), ZPixmap, 0, NULL, iconsize, iconsize, 32, 0);
+	if (!(img->data = calloc(img->bytes_per_line, iconsize))) {
+		die("fatal: could not malloc() %u bytes\n", img->bytes_per_line * iconsize);
+	}
+	for (y = 0; y < dh; y++) {
+		for (x = 0; x < dw; x++) {
+			v = scaled[y * dw + x];
+			if ((v >> 24 & 0xff) < 128) continue; /* transparent, masked out */
+			bits[(oy + y) * bpl + (ox + x) / 8] |= 1 << ((ox + x) % 8);
+			XPutPixel(img, ox + x, oy + y,
+					  ((v >> 16 & 0xff) * (mask[0] >> shift[0]) / 255) << shift[0]
+					| ((v >> 8 & 0xff) * (mask[1] >> shift[1]) / 255) << shift[1]
+					| ((v & 0xff) * (mask[2] >> shift[2]) / 255) << shift[2]);
+		}
+	}
+	icon->hash = hash;
+	icon->w = w;
+	icon->h = h;
+	icon->size = iconsize;
+	icon->refs = 1;
+	icon->pixmap = XCreatePixmap(dpy, root, iconsize, iconsize, DefaultDepth(dpy, screen));
+	icon->mask = XCreateBitmapFromData(dpy, root, bits, iconsize, iconsize);
+	gc = XCreateGC(dpy, icon->pixmap, 0, NULL);
+	XPutImage(dpy, icon->pixmap, gc, img, 0, 0, 0, 0, iconsize, iconsize);
+	XFreeGC(dpy, gc);
+	XDestroyImage(img); /* frees img->data too */
+	free(scaled);
+	free(bits);
+	icon->next = icons;
+	icons = icon;
+	return icon;
+}
+
+/**
+ * Drops a client's reference to an icon, freeing it when no client uses it anymore.
+ * 
+ * @param	icon	The icon, or NULL.
+ */
+void
+icon_release (Icon *icon) {
+	Icon **ip;
+
+	if (!icon || --icon->refs > 0) return;
+	for (ip = &icons; *ip && *ip != icon; ip = &(*ip)->next);
+	if (*ip) {
+		*ip = icon->next;
+	}
+	XFreePixmap(dpy, icon->pixmap);
+	XFreePixmap(dpy, icon->mask);
+	free(icon);
+}
+
+/**
+ * Scales an ARGB image with a box filter: each target pixel is the average of the source pixels it covers,
+ * weighted by their alpha so transparent pixels don't darken the edges. When enlarging, this is nearest neighbor.
+ * The filter is separable, so rows are filtered first, then columns; the inner loops are plain sums over
+ * arrays that the compiler can vectorize.
+ * 
+ * @param	src	The source pixels.
+ * @param	sw	The source width.
+ * @param	sh	The source height.
+ * @param	dst	The target pixels.
+ * @param	dw	The target width.
+ * @param	dh	The target height.
+ */
+void
+icon_scale (const unsigned long *src, int sw, int sh, unsigned long *dst, int dw, int dh) {
+	int x, y, i, j, n, k;
+	unsigned long sum[4], a, v;
+	unsigned long *tmp;	/* rows filtered horizontally: alpha and premultiplied red, green and blue */
+
+	if (!(tmp = malloc(dw * sh * 4 * sizeof(unsigned long)))) {
+		die("fatal: could not malloc() %u bytes\n", dw * sh * 4 * sizeof(unsigned long));
+	}
+	for (y = 0; y < sh; y++) {
+		for (x = 0; x < dw; x++) {
+			i = x * sw / dw;
+			n = MAX(i + 1, (x + 1) * sw / dw) - i;
+			sum[0] = sum[1] = sum[2] = sum[3] = 0;
+			for (j = i; j < i + n; j++) {
+				v = src[y * sw + j];
+				a = v >> 24 & 0xff;
+				sum[0] += a;
+				sum[1] += (v >> 16 & 0xff) * a;
+				sum[2] += (v >> 8 & 0xff) * a;
+				sum[3] += (v & 0xff) * a;
+			}
+			for (k = 0; k < 4; k++) {
+				tmp[(y * dw + x) * 4 + k] = sum[k] / n;
+			}
+		}
+	}
+	for (y = 0; y < dh; y++) {
+		i = y * sh / dh;
+		n = MAX(i + 1, (y + 1) * sh / dh) - i;
+		for (x = 0; x < dw; x++) {
+			sum[0] = sum[1] = sum[2] = sum[3] = 0;
+			for (j = i; j < i + n; j++) {
+				for (k = 0; k < 4; k++) {
+					sum[k] += tmp[(j * dw + x) * 4 + k];
+				}
+			}
+			a = sum[0] / n;
+			for (k = 1; k < 4; k++) { /* unpremultiply, the rounding above may push this past 255 */
+				sum[k] = sum[0] ? MIN(255, sum[k] / sum[0]) : 0;
+			}
+			dst[y * dw + x] = a << 24 | sum[1] << 16 | sum[2] << 8 | sum[3];
+		}
+	}
+	free(tmp);
+}
+
+/**
+ * Initializes (or reinitializes) the windows that represent the tag and client bars, along with the crossing
+ * window of each monitor.
+ * Crossing windows cover their monitor below all clients, so moving the pointer over the desktop only produces
+ * an event when it enters another monitor (instead of tracking every motion on the root window).
+ */
+void
+init_bars (void) {
+	Monitor *m;
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.background_pixmap = ParentRelative,
+		.event_mask = ButtonPressMask|ExposureMask
+	};
+	XSetWindowAttributes cwa = {
+		.override_redirect = True,
+		.event_mask = EnterWindowMask,
+		.cursor = cursor[CursorNormal]
+	};
+	
+	for (m = mons; m; m = m->next) {
+		if (m->tagbar_win) continue;
+		
+		m->tagbar_win = XCreateWindow(dpy, root, m->winarea_x, m->tagbar_pos, m->winarea_width, bh, 0, DefaultDepth(dpy, screen),
+								  CopyFromParent, DefaultVisual(dpy, screen),
+								  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+		XDefineCursor(dpy, m->tagbar_win, cursor[CursorNormal]);
+		XMapRaised(dpy, m->tagbar_win);
+		m->clientbar_win = XCreateWindow(dpy, root, m->winarea_x, m->clientbar_pos, m->winarea_width, th, 0, DefaultDepth(dpy, screen),
+					  CopyFromParent, DefaultVisual(dpy, screen),
+					  CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+		XDefineCursor(dpy, m->clientbar_win, cursor[CursorNormal]);
+		if (show_previews) {
+			XSelectInput(dpy, m->clientbar_win, wa.event_mask|PointerMotionMask|LeaveWindowMask);
+		}
+		XMapRaised(dpy, m->clientbar_win);
+		m->crossing_win = XCreateWindow(dpy, root, m->mon_x, m->mon_y, m->mon_width, m->mon_height, 0, 0,
+					  InputOnly, DefaultVisual(dpy, screen),
+					  CWOverrideRedirect|CWEventMask|CWCursor, &cwa);
+		XMapWindow(dpy, m->crossing_win);
+		XLowerWindow(dpy, m->crossing_win);
+	}
+}
 
 
 #ifdef XINERAMA
@@ -2279,6 +3499,167 @@ is_geom_unique (XineramaScreenInfo *unique, size_t n, XineramaScreenInfo *info)
 }
 #endif /* XINERAMA */
 
+/**
+ * Interns all atoms the WM uses in a single round trip.
+ */
+void
+intern_atoms (void) {
+	char *names[WMLast + NetLast + WasdwmLast + 1] = {
+		[WMProtocols] = "WM_PROTOCOLS",
+		[WMDelete] = "WM_DELETE_WINDOW",
+		[WMState] = "WM_STATE",
+		[WMTakeFocus] = "WM_TAKE_FOCUS",
+		[WMLast + NetSupported] = "_NET_SUPPORTED",
+		[WMLast + NetWMName] = "_NET_WM_NAME",
+		[WMLast + NetWMState] = "_NET_WM_STATE",
+		[WMLast + NetWMFullscreen] = "_NET_WM_STATE_FULLSCREEN",
+		[WMLast + NetActiveWindow] = "_NET_ACTIVE_WINDOW",
+		[WMLast + NetWMWindowType] = "_NET_WM_WINDOW_TYPE",
+		[WMLast + NetWMWindowTypeDialog] = "_NET_WM_WINDOW_TYPE_DIALOG",
+		[WMLast + NetClientList] = "_NET_CLIENT_LIST",
+		[WMLast + NetWMCheck] = "_NET_SUPPORTING_WM_CHECK",
+		[WMLast + NetWMPid] = "_NET_WM_PID",
+		[WMLast + NetWMIcon] = "_NET_WM_ICON",
+		[WMLast + NetLast + WasdwmStats] = "_WASDWM_STATS",
+		[WMLast + NetLast + WasdwmState] = "_WASDWM_STATE",
+		[WMLast + NetLast + WasdwmCommand] = "_WASDWM_COMMAND",
+		[WMLast + NetLast + WasdwmLast] = "UTF8_STRING"
+	};
+	Atom atoms[LENGTH(names)];
+
+	XInternAtoms(dpy, names, LENGTH(names), False, atoms);
+	memcpy(wmatom, atoms, sizeof wmatom);
+	memcpy(netatom, atoms + WMLast, sizeof netatom);
+	memcpy(wasdwmatom, atoms + WMLast + NetLast, sizeof wasdwmatom);
+	utf8string = atoms[WMLast + NetLast + WasdwmLast];
+}
+
+/**
+ * Spawns the executable chosen in the launcher like cmd_spawn. If nothing matches, the query is run by the shell,
+ * so commands with arguments can be typed as well.
+ * 
+ * @param	item	The chosen item, or NULL.
+ * @param	query	The text typed into the launcher.
+ */
+void
+launcher_select (MenuItem *item, const char *query) {
+	const char *argv[4] = { NULL };
+	Arg a = { .v = argv };
+
+	if (item) {
+		argv[0] = item->text;
+	} else if (*query) {
+		argv[0] = "/bin/sh";
+		argv[1] = "-c";
+		argv[2] = query;
+	} else {
+		return;
+	}
+	cmd_spawn(&a);
+}
+
+/**
+ * Reuses the geometry the layout computed when the selected tag was last arranged, if nothing it depends on
+ * has changed since: the monitor's clients (see Monitor.version), the tagset, the window area, the layout and
+ * the marked width, as well as which clients are tiled, their order, marks and borders.
+ * Returns False if the layout has to run.
+ * 
+ * @param	m	The target monitor.
+ */
+Bool
+layout_cache_apply (Monitor *m) {
+	int i;
+	Client *c;
+	Rect *r;
+	LayoutCache *lc = &get_tag_state(m, m->pertag->curtag)->cache;
+
+	if (!lc->valid || lc->version != m->version || !tagset_equal(&lc->tagset, &m->tagset[m->selected_tags])
+			|| lc->layout != m->layout[m->selected_layout] || lc->marked_width != m->marked_width
+			|| lc->area.x != m->winarea_x || lc->area.y != m->winarea_y
+			|| lc->area.w != m->winarea_width || lc->area.h != m->winarea_height) {
+		return False;
+	}
+	for (i = 0, c = next_tiled(m->clients); c; c = next_tiled(c->next), i++) {
+		if (i == lc->n || lc->geoms[i].c != c || lc->geoms[i].marked != c->marked || lc->geoms[i].bw != c->bw) {
+			return False;
+		}
+	}
+	if (i != lc->n) return False;
+
+	for (i = 0; i < lc->n; i++) {
+		c = lc->geoms[i].c;
+		r = &lc->geoms[i].r;
+		if (c->x != r->x || c->y != r->y || c->w != r->w || c->h != r->h) { /* moved by another tag's layout */
+			resize_client(c, r->x, r->y, r->w, r->h);
+		}
+	}
+	strncpy(m->layout_symbol, lc->layout_symbol, sizeof m->layout_symbol);
+	return True;
+}
+
+/**
+ * Remembers the geometry the layout just computed for the selected tag (see layout_cache_apply).
+ * 
+ * @param	m	The target monitor.
+ */
+void
+layout_cache_store (Monitor *m) {
+	int n;
+	Client *c;
+	LayoutCache *lc = &get_tag_state(m, m->pertag->curtag)->cache;
+
+	for (n = 0, c = next_tiled(m->clients); c; c = next_tiled(c->next), n++);
+	if (n > lc->size) {
+		lc->size = MAX(n, 2 * lc->size);
+		if (!(lc->geoms = realloc(lc->geoms, lc->size * sizeof(CachedGeom)))) {
+			die("fatal: could not malloc() %u bytes\n", lc->size * sizeof(CachedGeom));
+		}
+	}
+	lc->valid = True;
+	lc->version = m->version;
+	lc->tagset = m->tagset[m->selected_tags];
+	lc->layout = m->layout[m->selected_layout];
+	lc->marked_width = m->marked_width;
+	lc->area.x = m->winarea_x;
+	lc->area.y = m->winarea_y;
+	lc->area.w = m->winarea_width;
+	lc->area.h = m->winarea_height;
+	strncpy(lc->layout_symbol, m->layout_symbol, sizeof lc->layout_symbol);
+	for (n = 0, c = next_tiled(m->clients); c; c = next_tiled(c->next), n++) {
+		lc->geoms[n].c = c;
+		lc->geoms[n].r.x = c->x;
+		lc->geoms[n].r.y = c->y;
+		lc->geoms[n].r.w = c->w;
+		lc->geoms[n].r.h = c->h;
+		lc->geoms[n].bw = c->bw;
+		lc->geoms[n].marked = c->marked;
+	}
+	lc->n = n;
+}
+
+/**
+ * Prints the time spent in a startup phase (since the previous call), if requested with -t.
+ * 
+ * @param	phase	The name of the phase that just finished.
+ */
+void
+log_startup_phase (const char *phase) {
+	static struct timespec start, last;
+	struct timespec now;
+
+	if (!show_timings) return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!phase) { /* start the clock */
+		start = last = now;
+		return;
+	}
+	fprintf(stderr, "wasdwm: %-10s %8.3f ms (%8.3f ms total)\n", phase,
+			(now.tv_sec - last.tv_sec) * 1e3 + (now.tv_nsec - last.tv_nsec) / 1e6,
+			(now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6);
+	last = now;
+}
+
 /**
  * Begin managing a window.
  * 
@@ -2290,22 +3671,29 @@ manage (Window w, XWindowAttributes *wa) {
 	Client *c, *t = NULL;
 	Window trans = None;
 	XWindowChanges wc;
-	Arg wintag;
 
 	if (!(c = calloc(1, sizeof(Client)))) {
 		die("fatal: could not malloc() %u bytes\n", sizeof(Client));
 	}
 	c->win = w;
+	c->titletimer.func = refresh_title;
+	c->titletimer.arg = c;
 	update_title(c);
 	c->minimized = c->marked = False;
 	c->onscreen = True;
 	if (XGetTransientForHint(dpy, w, &trans) && (t = window_to_client(trans))) {
 		c->mon = t->mon;
 		c->tags = t->tags;
+		c->pid = t->pid;
+		memcpy(c->class, t->class, sizeof c->class);
 	} else {
 		c->mon = selmon;
 		apply_rules(c);
 	}
+	if (!t) {
+		c->pid = c->deprioritize ? get_client_pid(c) : -1; /* the others are looked up when needed */
+	}
+	spawn_match(c);
 	/* geometry */
 	c->x = c->oldx = wa->x;
 	c->y = c->oldy = wa->y;
@@ -2332,17 +3720,24 @@ manage (Window w, XWindowAttributes *wa) {
 	update_window_type(c);
 	update_size_hints(c);
 	update_wm_hints(c);
+	update_icon(c);
 	XSelectInput(dpy, w, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
 	grab_buttons(c, False);
 	c->wasfloating = False;
 	if (!c->isfloating) {
 		c->isfloating = c->oldstate = trans != None || c->isfixed;
 	}
+	/* place windows that don't ask for a position (or ask for the origin) ourselves */
+	if (smart_placement && c->isfloating && !c->isfullscreen && !(c->hintflags & USPosition)
+			&& (!(c->hintflags & PPosition) || (wa->x == 0 && wa->y == 0))) {
+		place_client(c);
+	}
 	if (c->isfloating) {
 		XRaiseWindow(dpy, c->win);
 	}
 	attach(c);
 	stack_attach(c);
+	snap_index_update(c);
 	XChangeProperty(dpy, root, netatom[NetClientList], XA_WINDOW, 32, PropModeAppend,
 					(unsigned char *) &(c->win), 1);
 	XMoveResizeWindow(dpy, c->win, c->x + 2 * sw, c->y, c->w, c->h); /* some windows require this */
@@ -2354,15 +3749,211 @@ manage (Window w, XWindowAttributes *wa) {
 	arrange(c->mon);
 	XMapWindow(dpy, c->win);
 	
-	if (follow_new_windows && !(c->tags & c->mon->tagset[c->mon->selected_tags])) {
-		wintag.ui = c->tags;
-		cmd_view_tag(&wintag);
-		
+	if (follow_new_windows && !TAGISVISIBLE(c) && !c->scratchpad) {
+		view_tagset(&c->tags);
 	}
 	restack(selmon);
 	focus(c);	/* used to be focus(NULL) for unknown reasons, but that prevents certain windows from acquiring focus properly.  Hopefully this doesn't break anything */
 }
 
+/**
+ * Closes the menu and frees its items.
+ */
+void
+menu_close (void) {
+	if (!menu.win) return;
+	XUngrabKeyboard(dpy, CurrentTime);
+	XDestroyWindow(dpy, menu.win);
+	free(menu.items);
+	free(menu.strings);
+	free(menu.matches);
+	free(menu.rest);
+	memset(&menu, 0, sizeof menu);
+}
+
+/**
+ * Draws the query and the visible rows of matches. Only the menu_lines rows starting at menu.top are drawn,
+ * however many items match.
+ */
+void
+menu_draw (void) {
+	int i;
+	char buf[MENUQUERYLEN + 32];
+	unsigned int w = menu.mon->winarea_width;
+
+	snprintf(buf, sizeof buf, "%s_  (%d/%d)", menu.query, menu.nmatches, menu.nitems);
+	gfx_set_colorscheme(drw, &scheme[SchemeVisible]);
+	gfx_draw_text(drw, 0, 0, w, bh, buf);
+	for (i = 0; i < menu_lines; i++) {
+		if (menu.top + i < menu.nmatches) {
+			gfx_set_colorscheme(drw, menu.top + i == menu.sel ? &scheme[SchemeSel] : &scheme[SchemeNorm]);
+			gfx_draw_text(drw, 0, (i + 1) * bh, w, bh, menu.items[menu.matches[menu.top + i]].text);
+		} else {
+			gfx_set_colorscheme(drw, &scheme[SchemeNorm]);
+			gfx_draw_text(drw, 0, (i + 1) * bh, w, bh, NULL);
+		}
+	}
+	gfx_render_to_window(drw, menu.win, 0, 0, w, (menu_lines + 1) * bh);
+}
+
+/**
+ * Updates the matches after the query changed. Items starting with the query come first, followed by the other
+ * fuzzy matches. When the query only grew, the items that didn't match before can't match now, and prefix
+ * matches can only have been prefix matches before, so only the previous matches are tested again.
+ */
+void
+menu_filter (void) {
+	int i, n = 0, nrest = 0;
+	const char *text;
+
+	if (menu.len < menu.matchedlen) { /* the query got shorter, start over */
+		for (i = 0; i < menu.nitems; i++) {
+			menu.matches[i] = i;
+		}
+		menu.nmatches = menu.nitems;
+	}
+	for (i = 0; i < menu.nmatches; i++) {
+		text = menu.items[menu.matches[i]].text;
+		if (!strncasecmp(text, menu.query, menu.len)) {
+			menu.matches[n++] = menu.matches[i];
+		} else if (fuzzy_match(menu.query, text)) {
+			menu.rest[nrest++] = menu.matches[i];
+		}
+	}
+	memcpy(menu.matches + n, menu.rest, nrest * sizeof(int));
+	menu.nmatches = n + nrest;
+	menu.matchedlen = menu.len;
+	menu.sel = menu.top = 0;
+}
+
+/**
+ * Handles a key press while the menu is open (the keyboard is grabbed then). Typing edits the query, Up/Down and
+ * (Shift+)Tab move the selection, Return chooses the selected item and Escape closes the menu.
+ * Returns False if the menu isn't open.
+ * 
+ * @param	ev	The key event.
+ */
+Bool
+menu_key (XKeyEvent *ev) {
+	int n;
+	char buf[32];
+	KeySym keysym;
+
+	if (!menu.win) return False;
+	n = XLookupString(ev, buf, sizeof buf, &keysym, NULL);
+	if ((ev->state & ControlMask) && keysym == XK_u) {
+		menu.query[menu.len = 0] = '\0';
+		menu_filter();
+		menu_draw();
+		return True;
+	}
+	switch (keysym) {
+		case XK_Escape:
+			menu_close();
+			return True;
+		case XK_Return:
+		case XK_KP_Enter:
+			menu.select(menu.nmatches ? &menu.items[menu.matches[menu.sel]] : NULL, menu.query);
+			menu_close();
+			return True;
+		case XK_Up:
+		case XK_ISO_Left_Tab:
+			if (menu.sel > 0) {
+				menu.sel--;
+			}
+			break;
+		case XK_Down:
+		case XK_Tab:
+			if (menu.sel < menu.nmatches - 1) {
+				menu.sel++;
+			}
+			break;
+		case XK_BackSpace:
+			if (menu.len) {
+				menu.query[--menu.len] = '\0';
+				menu_filter();
+			}
+			break;
+		default:
+			if (n > 0 && !iscntrl((unsigned char)buf[0]) && menu.len + n < MENUQUERYLEN) {
+				memcpy(menu.query + menu.len, buf, n);
+				menu.query[menu.len += n] = '\0';
+				menu_filter();
+			}
+			break;
+	}
+	if (menu.sel < menu.top) {
+		menu.top = menu.sel;
+	} else if (menu.sel >= menu.top + menu_lines) {
+		menu.top = menu.sel - menu_lines + 1;
+	}
+	menu_draw();
+	return True;
+}
+
+/**
+ * Opens a menu at the top of the selected monitor and grabs the keyboard for it (see menu_key).
+ * 
+ * @param	items	The items to choose from, freed with the menu.
+ * @param	nitems	The number of items.
+ * @param	strings	Storage of the item texts to free with the menu, or NULL.
+ * @param	select	Called with the chosen item and the query.
+ */
+void
+menu_open (MenuItem *items, int nitems, char *strings, void (*select)(MenuItem *item, const char *query)) {
+	int i;
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.background_pixmap = ParentRelative,
+		.event_mask = ExposureMask
+	};
+
+	menu_close();
+	if (XGrabKeyboard(dpy, root, True, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess) {
+		free(items);
+		free(strings);
+		return;
+	}
+	if (!(menu.matches = malloc((nitems + 1) * sizeof(int))) || !(menu.rest = malloc((nitems + 1) * sizeof(int)))) {
+		die("fatal: could not malloc() %u bytes\n", 2 * (nitems + 1) * sizeof(int));
+	}
+	for (i = 0; i < nitems; i++) {
+		menu.matches[i] = i;
+	}
+	menu.nmatches = menu.nitems = nitems;
+	menu.items = items;
+	menu.strings = strings;
+	menu.select = select;
+	menu.mon = selmon;
+	menu.win = XCreateWindow(dpy, root, selmon->winarea_x, selmon->winarea_y, selmon->winarea_width,
+			(menu_lines + 1) * bh, 0, DefaultDepth(dpy, screen), CopyFromParent, DefaultVisual(dpy, screen),
+			CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+	XMapRaised(dpy, menu.win);
+	menu_draw();
+}
+
+/**
+ * Removes the items referring to some data (e.g. a client that went away) from the open menu.
+ * 
+ * @param	data	The data of the items to remove.
+ */
+void
+menu_remove (void *data) {
+	int i, n = 0;
+
+	if (!menu.win) return;
+	for (i = 0; i < menu.nitems; i++) {
+		if (menu.items[i].data != data) {
+			menu.items[n++] = menu.items[i];
+		}
+	}
+	if (n == menu.nitems) return;
+	menu.nitems = n;
+	menu.matchedlen = menu.len + 1; /* indexes changed, filter all items again */
+	menu_filter();
+	menu_draw();
+}
+
 /**
  * Cleans up WM resources associated with a monitor.
  * 
@@ -2370,8 +3961,15 @@ manage (Window w, XWindowAttributes *wa) {
  */
 void
 monitor_cleanup (Monitor *mon) {
+	int i;
 	Monitor *m;
 
+	if (menu.mon == mon) {
+		menu_close();
+	}
+	if (preview.mon == mon) {
+		preview_close();
+	}
 	if (mon == mons) {
 		mons = mons->next;
 	} else {
@@ -2382,6 +3980,16 @@ monitor_cleanup (Monitor *mon) {
 	XDestroyWindow(dpy, mon->tagbar_win);
 	XUnmapWindow(dpy, mon->clientbar_win);
 	XDestroyWindow(dpy, mon->clientbar_win);
+	XDestroyWindow(dpy, mon->crossing_win);
+	free(mon->xedges.edges);
+	free(mon->yedges.edges);
+	for (i = 0; i <= MAXTAGS; i++) {
+		if (mon->pertag->tags[i]) {
+			free(mon->pertag->tags[i]->cache.geoms);
+			free(mon->pertag->tags[i]);
+		}
+	}
+	free(mon->pertag);
 	free(mon);
 }
 
@@ -2391,12 +3999,12 @@ monitor_cleanup (Monitor *mon) {
 Monitor *
 monitor_create (void) {
 	Monitor *m;
-	int i;
 
 	if (!(m = (Monitor *)calloc(1, sizeof(Monitor)))) {
 		die("fatal: could not malloc() %u bytes\n", sizeof(Monitor));
 	}
-	m->tagset[0] = m->tagset[1] = 1;
+	TAGSET_ADD(m->tagset[0], 0);
+	TAGSET_ADD(m->tagset[1], 0);
 	m->marked_width = marked_width;
 	m->num_marked_win = 0;
 	m->show_tagbar = show_tagbar;
@@ -2411,19 +4019,128 @@ monitor_create (void) {
 		die("fatal: could not malloc() %u bytes\n", sizeof(Pertag));
 	}
 	m->pertag->curtag = m->pertag->prevtag = 1;
-	for (i=0; i <= LENGTH(tags); i++) {
-		/* init marked_widths */
-		m->pertag->marked_widths[i] = m->marked_width;
+	return m;
+}
 
-		/* init layouts */
-		m->pertag->layoutidxs[i][0] = m->layout[0];
-		m->pertag->layoutidxs[i][1] = m->layout[1];
-		m->pertag->selected_layouts[i] = m->selected_layout;
+/**
+ * Rebuilds the index used to look monitors up by number, position and direction.
+ * The distinct monitor edges split the screen into a grid of cells which are mapped to the monitor covering them,
+ * so point lookups are two binary searches. Neighbours are the nearest monitors past each edge, preferring monitors
+ * that overlap along that edge.
+ */
+void
+monitor_index_update (void) {
+	int i, j, k, n, gap, overlap, offset, x0, x1, y0, y1;
+	long long key, best;
+	Monitor *m, *o;
+
+	for (n = 0, m = mons; m; m = m->next, n++);
+	free(monindex.mons);
+	free(monindex.xs);
+	free(monindex.ys);
+	free(monindex.cells);
+	if (!(monindex.mons = malloc(n * sizeof(Monitor *)))
+			|| !(monindex.xs = malloc(2 * n * sizeof(int)))
+			|| !(monindex.ys = malloc(2 * n * sizeof(int)))) {
+		die("fatal: could not malloc() %u bytes\n", 2 * n * sizeof(int));
+	}
+	monindex.n = n;
+	for (i = 0, m = mons; m; m = m->next, i++) {
+		monindex.mons[m->num % n] = m;
+		monindex.xs[2 * i] = m->mon_x;
+		monindex.xs[2 * i + 1] = m->mon_x + m->mon_width;
+		monindex.ys[2 * i] = m->mon_y;
+		monindex.ys[2 * i + 1] = m->mon_y + m->mon_height;
+	}
+	qsort(monindex.xs, 2 * n, sizeof(int), _cmpint);
+	qsort(monindex.ys, 2 * n, sizeof(int), _cmpint);
+	for (i = j = 1; i < 2 * n; i++) {
+		if (monindex.xs[i] != monindex.xs[j - 1]) {
+			monindex.xs[j++] = monindex.xs[i];
+		}
+	}
+	monindex.nx = j;
+	for (i = j = 1; i < 2 * n; i++) {
+		if (monindex.ys[i] != monindex.ys[j - 1]) {
+			monindex.ys[j++] = monindex.ys[i];
+		}
+	}
+	monindex.ny = j;
+	if (!(monindex.cells = calloc((monindex.nx - 1) * (monindex.ny - 1) + 1, sizeof(Monitor *)))) {
+		die("fatal: could not malloc() %u bytes\n", (monindex.nx - 1) * (monindex.ny - 1) * sizeof(Monitor *));
+	}
+	for (m = mons; m; m = m->next) { /* where monitors overlap, the first one wins */
+		x0 = get_lower_bound(monindex.xs, monindex.nx, sizeof(int), m->mon_x);
+		x1 = get_lower_bound(monindex.xs, monindex.nx, sizeof(int), m->mon_x + m->mon_width);
+		y0 = get_lower_bound(monindex.ys, monindex.ny, sizeof(int), m->mon_y);
+		y1 = get_lower_bound(monindex.ys, monindex.ny, sizeof(int), m->mon_y + m->mon_height);
+		for (j = y0; j < y1; j++) {
+			for (i = x0; i < x1; i++) {
+				if (!monindex.cells[j * (monindex.nx - 1) + i]) {
+					monindex.cells[j * (monindex.nx - 1) + i] = m;
+				}
+			}
+		}
+	}
+
+	/* neighbours: smallest gap first, monitors that overlap along the edge before those that don't */
+	for (m = mons; m; m = m->next) {
+		for (k = 0; k < DirLast; k++) {
+			m->neighbours[k] = NULL;
+			best = 0;
+			for (o = mons; o; o = o->next) {
+				if (o == m) continue;
+				if (k == DirLeft || k == DirRight) {
+					gap = k == DirLeft ? m->mon_x - (o->mon_x + o->mon_width) : o->mon_x - (m->mon_x + m->mon_width);
+					overlap = MIN(m->mon_y + m->mon_height, o->mon_y + o->mon_height) - MAX(m->mon_y, o->mon_y);
+					offset = abs((2 * o->mon_y + o->mon_height) - (2 * m->mon_y + m->mon_height));
+				} else {
+					gap = k == DirUp ? m->mon_y - (o->mon_y + o->mon_height) : o->mon_y - (m->mon_y + m->mon_height);
+					overlap = MIN(m->mon_x + m->mon_width, o->mon_x + o->mon_width) - MAX(m->mon_x, o->mon_x);
+					offset = abs((2 * o->mon_x + o->mon_width) - (2 * m->mon_x + m->mon_width));
+				}
+				if (gap < 0) continue;
+				key = ((long long)(overlap <= 0) << 62) | ((long long)gap << 31) | offset;
+				if (!m->neighbours[k] || key < best) {
+					m->neighbours[k] = o;
+					best = key;
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Returns the index of the occupied tag a given number of tags to the left/right of the first viewed tag
+ * (skipping empty tags), or -1 if no tag is occupied.
+ * 
+ * @param	m	The target monitor.
+ * @param	dir	The number of tags to shift right (positive value) or left (negative value).
+ */
+int
+next_occupied_tag (Monitor *m, int dir) {
+	Tagset occ = {{0}};
+	int seltag;
+	Client *c;
 
-		/* init show_tagbar */
-		m->pertag->show_tagbars[i] = m->show_tagbar;
+	for (c = m->clients; c; c = c->next) {
+		tagset_or(&occ, &c->tags);
 	}
-	return m;
+	tagset_and(&occ, &tagmask);
+		
+	if (tagset_empty(&occ)) return -1;
+	
+	if ((seltag = tagset_first(&m->tagset[m->selected_tags])) < 0) {
+		seltag = 0;
+	}
+	
+	do {
+		seltag = (seltag + dir) % (int)numtags;
+		if (seltag < 0) {
+			seltag += numtags;
+		}
+	} while (!TAGSET_HAS(occ, seltag));
+	return seltag;
 }
 
 /**
@@ -2438,51 +4155,786 @@ next_tiled (Client *c) {
 }
 
 /**
- * Brings a client to the top of its monitor's focus stack and gives it focus.
- * 
- * @param	c	The client on which to focus.
+ * Creates the (unmapped) windows that make up the outline used by outline-mode moves and resizes.
+ * The outline is built from four thin override-redirect windows, so the clients below it are never redrawn.
  */
 void
-pop (Client *c) {
-	detach(c);
-	attach(c);
-	focus(c);
-	arrange(c->mon);
+outline_create (void) {
+	int i;
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.background_pixel = scheme[SchemeSel].border->rgb
+	};
+
+	for (i = 0; i < LENGTH(outline_wins); i++) {
+		if (!outline_wins[i]) {
+			outline_wins[i] = XCreateWindow(dpy, root, 0, 0, 1, 1, 0, DefaultDepth(dpy, screen),
+											CopyFromParent, DefaultVisual(dpy, screen),
+											CWOverrideRedirect|CWBackPixel, &wa);
+		}
+	}
 }
 
 /**
- * Steps backward through the client list (starting with the argument c) looking for a tiled client.
- * 
- * @param	c The first client to test.
+ * Destroys the move/resize outline.
  */
-Client *
-prev_tiled (Client *c) {
-	Client *p, *r;
+void
+outline_free (void) {
+	int i;
 
-	for (p = selmon->clients, r = NULL; p && p != c; p = p->next) {
-		if (!p->isfloating && TAGISVISIBLE(p)) {
-			r = p;
+	for (i = 0; i < LENGTH(outline_wins); i++) {
+		if (outline_wins[i]) {
+			XDestroyWindow(dpy, outline_wins[i]);
+			outline_wins[i] = None;
 		}
 	}
-	return r;
 }
 
 /**
- * Returns the monitor associated with a rectangular region.
+ * Moves the move/resize outline so it frames a given rectangle, mapping it if necessary.
+ * 
+ * @param	x	The x coordinate of the rectangle.
+ * @param	y	The y coordinate of the rectangle.
+ * @param	w	The width of the rectangle (including borders).
+ * @param	h	The height of the rectangle (including borders).
+ */
+void
+outline_move (int x, int y, int w, int h) {
+	int i, t = MIN((int)outlinepx, MIN(w, h) / 2);
+
+	if (!outline_wins[0]) return;
+
+	t = MAX(t, 1);
+	XMoveResizeWindow(dpy, outline_wins[0], x, y, MAX(w, 1), t);
+	XMoveResizeWindow(dpy, outline_wins[1], x, y + MAX(h - t, 0), MAX(w, 1), t);
+	XMoveResizeWindow(dpy, outline_wins[2], x, y, t, MAX(h, 1));
+	XMoveResizeWindow(dpy, outline_wins[3], x + MAX(w - t, 0), y, t, MAX(h, 1));
+	for (i = 0; i < LENGTH(outline_wins); i++) {
+		XMapRaised(dpy, outline_wins[i]);
+	}
+	XFlush(dpy);
+}
+
+/**
+ * Frees the $PATH index and stops watching its directories.
+ */
+void
+path_index_free (void) {
+	int i;
+
+	timer_disarm(&pathtimer);
+	for (i = 0; i < npathdirs; i++) {
+		free(pathdirs[i].path);
+		free(pathdirs[i].pool);
+		free(pathdirs[i].names);
+	}
+	free(pathdirs);
+	free(pathnames);
+	pathdirs = NULL;
+	pathnames = NULL;
+	npathdirs = npathnames = 0;
+	if (inotifyfd >= 0) {
+		close(inotifyfd); /* also removes the watches */
+		inotifyfd = -1;
+	}
+}
+
+/**
+ * Splits $PATH into the directories the launcher indexes and starts watching them for changes.
+ * For directories that can't be watched, cmd_launch tries again and compares their modification times.
+ * The first scan happens on a timer, so it doesn't delay startup.
+ */
+void
+path_index_init (void) {
+	char *path, *dir, *p;
+	int i;
+
+	if (!(path = getenv("PATH")) || !(path = strdup(path))) return;
+	for (npathdirs = 1, p = path; *p; p++) {
+		npathdirs += (*p == ':');
+	}
+	if (!(pathdirs = calloc(npathdirs, sizeof(PathDir)))) {
+		die("fatal: could not malloc() %u bytes\n", npathdirs * sizeof(PathDir));
+	}
+#ifdef __linux__
+	inotifyfd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+#endif /* __linux__ */
+	for (npathdirs = 0, dir = strtok(path, ":"); dir; dir = strtok(NULL, ":")) {
+		for (i = 0; i < npathdirs && strcmp(pathdirs[i].path, dir); i++);
+		if (i < npathdirs) continue; /* listed twice */
+		if (!(pathdirs[npathdirs].path = strdup(dir))) {
+			die("fatal: could not malloc() %u bytes\n", strlen(dir) + 1);
+		}
+		pathdirs[npathdirs].wd = -1;
+		path_index_watch(&pathdirs[npathdirs]);
+		pathdirs[npathdirs++].stale = True;
+	}
+	free(path);
+	timer_arm(&pathtimer, PATH_RESCAN_DELAY);
+}
+
+/**
+ * Reads the pending inotify events and marks the directories they concern for rescanning.
+ * The rescan is delayed a little, so installing a package rescans each directory once.
+ */
+void
+path_index_read (void) {
+#ifdef __linux__
+	union {
+		struct inotify_event ev;
+		char buf[4096];
+	} u;
+	struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	int i;
+
+	while ((len = read(inotifyfd, u.buf, sizeof u.buf)) > 0) {
+		for (p = u.buf; p < u.buf + len; p += sizeof(struct inotify_event) + ev->len) {
+			ev = (struct inotify_event *) p;
+			for (i = 0; i < npathdirs; i++) {
+				if (ev->mask & IN_Q_OVERFLOW) { /* events were lost, anything may have changed */
+					pathdirs[i].stale = True;
+				} else if (pathdirs[i].wd == ev->wd) {
+					pathdirs[i].stale = True;
+					if (ev->mask & IN_IGNORED) { /* the directory is gone */
+						pathdirs[i].wd = -1;
+					}
+				}
+			}
+		}
+	}
+	if (!pathtimer.armed) {
+		timer_arm(&pathtimer, PATH_RESCAN_DELAY);
+	}
+#endif /* __linux__ */
+}
+
+/**
+ * Lists the executables in a directory of the $PATH index. A missing or unreadable directory contributes nothing.
+ * 
+ * @param	d	The target directory.
+ */
+void
+path_index_scan_dir (PathDir *d) {
+	DIR *dp;
+	struct dirent *de;
+	struct stat st;
+	char file[4096];
+	size_t len, used = 0, *offsets = NULL;
+	int i, size = 0;
+
+	d->n = 0;
+	d->stale = False;
+	if (stat(d->path, &st) || !(dp = opendir(d->path))) {
+		d->mtime = 0;
+		return;
+	}
+	d->mtime = st.st_mtime;
+	while ((de = readdir(dp))) {
+		if (de->d_name[0] == '.' || (size_t) snprintf(file, sizeof file, "%s/%s", d->path, de->d_name) >= sizeof file
+				|| stat(file, &st) || !S_ISREG(st.st_mode) || access(file, X_OK)) {
+			continue;
+		}
+		len = strlen(de->d_name) + 1;
+		if (used + len > d->poolsize) {
+			d->poolsize = MAX(2 * d->poolsize, used + len + 1024);
+			if (!(d->pool = realloc(d->pool, d->poolsize))) {
+				die("fatal: could not realloc() %u bytes\n", d->poolsize);
+			}
+		}
+		if (d->n == size) {
+			size = size ? 2 * size : 64;
+			if (!(offsets = realloc(offsets, size * sizeof(size_t)))) {
+				die("fatal: could not realloc() %u bytes\n", size * sizeof(size_t));
+			}
+		}
+		memcpy(d->pool + used, de->d_name, len);
+		offsets[d->n++] = used;
+		used += len;
+	}
+	closedir(dp);
+	free(d->names);
+	if (!(d->names = malloc((d->n + 1) * sizeof(char *)))) {
+		die("fatal: could not malloc() %u bytes\n", (d->n + 1) * sizeof(char *));
+	}
+	for (i = 0; i < d->n; i++) { /* the pool may have moved while it grew */
+		d->names[i] = d->pool + offsets[i];
+	}
+	free(offsets);
+}
+
+/**
+ * Rescans the directories that changed and rebuilds the sorted list of executable names, keeping only the first
+ * of several executables with the same name, as the shell would. Postponed while the launcher shows the list.
+ * 
+ * @param	unused	Unused.
+ */
+void
+path_index_update (void *unused) {
+	int i, j, n, changed = 0;
+
+	if (menu.win && menu.select == launcher_select) {
+		timer_arm(&pathtimer, PATH_RESCAN_DELAY);
+		return;
+	}
+	timer_disarm(&pathtimer);
+	for (i = 0; i < npathdirs; i++) {
+		if (pathdirs[i].stale) {
+			path_index_scan_dir(&pathdirs[i]);
+			changed = 1;
+		}
+	}
+	if (!changed) return;
+	for (i = n = 0; i < npathdirs; i++) {
+		n += pathdirs[i].n;
+	}
+	free(pathnames);
+	if (!(pathnames = malloc((n + 1) * sizeof(char *)))) {
+		die("fatal: could not malloc() %u bytes\n", (n + 1) * sizeof(char *));
+	}
+	for (i = n = 0; i < npathdirs; i++) {
+		for (j = 0; j < pathdirs[i].n; j++) {
+			pathnames[n++] = pathdirs[i].names[j];
+		}
+	}
+	qsort(pathnames, n, sizeof(char *), _cmpstr);
+	for (i = j = 0; i < n; i++) {
+		if (!j || strcmp(pathnames[j - 1], pathnames[i])) {
+			pathnames[j++] = pathnames[i];
+		}
+	}
+	npathnames = j;
+}
+
+/**
+ * Starts watching a directory of the $PATH index for changes, unless it is watched already.
+ * Returns True if the directory is watched from now on.
+ * 
+ * @param	d	The target directory.
+ */
+Bool
+path_index_watch (PathDir *d) {
+#ifdef __linux__
+	if (inotifyfd < 0 || d->wd >= 0) return False;
+	d->wd = inotify_add_watch(inotifyfd, d->path, IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ATTRIB|IN_ONLYDIR);
+	return d->wd >= 0;
+#else
+	return False;
+#endif /* __linux__ */
+}
+
+/**
+ * Moves a floating client to the position in its monitor's window area where it overlaps the other visible floating clients the least.
+ * Ties are broken in favor of the topmost, then leftmost position.
+ * 
+ * For every candidate row (the window area edges and the top/bottom edges of the other clients), the total overlap
+ * is a piecewise linear function of x, so it is minimized by sweeping over the points where its slope changes.
+ * This takes O(n^2 log n) time for n floating clients.
+ * 
+ * @param	c	The target client.
+ */
+void
+place_client (Client *c) {
+	int i, j, n = 0, nys = 0, nev, a, b, dy, prevpos;
+	int w = WIDTH(c), h = HEIGHT(c), bestx, besty;
+	int *ys;
+	long long f, slope, best = -1;
+	Client *t;
+	Monitor *m = c->mon;
+	Rect *r;
+	SweepEvent *ev;
+
+	if (w > m->winarea_width || h > m->winarea_height) return;
+
+	for (t = m->clients; t; t = t->next) {
+		n++;
+	}
+	if (!(r = malloc((n + 1) * sizeof(Rect)))) {
+		die("fatal: could not malloc() %u bytes\n", (n + 1) * sizeof(Rect));
+	}
+	if (!(ys = malloc((2 * n + 2) * sizeof(int)))) {
+		die("fatal: could not malloc() %u bytes\n", (2 * n + 2) * sizeof(int));
+	}
+	if (!(ev = malloc((4 * n + 2) * sizeof(SweepEvent)))) {
+		die("fatal: could not malloc() %u bytes\n", (4 * n + 2) * sizeof(SweepEvent));
+	}
+	ys[nys++] = m->winarea_y;
+	ys[nys++] = m->winarea_y + m->winarea_height - h;
+	for (n = 0, t = m->clients; t; t = t->next) {
+		if (t == c || !t->isfloating || t->minimized || !tagset_intersects(&t->tags, &c->tags)) continue;
+		r[n].x = t->x;
+		r[n].y = t->y;
+		r[n].w = WIDTH(t);
+		r[n].h = HEIGHT(t);
+		ys[nys++] = r[n].y + r[n].h;	/* just below t */
+		ys[nys++] = r[n].y - h;	/* just above t */
+		n++;
+	}
+	qsort(ys, nys, sizeof(int), _cmpint);
+
+	bestx = m->winarea_x;
+	besty = m->winarea_y;
+	for (i = 0; i < nys && best != 0; i++) {
+		if (ys[i] < m->winarea_y || ys[i] > m->winarea_y + m->winarea_height - h
+				|| (i > 0 && ys[i] == ys[i - 1])) {
+			continue;
+		}
+		/* the window area bounds are evaluated, but don't change the slope */
+		ev[0].pos = m->winarea_x;
+		ev[1].pos = m->winarea_x + m->winarea_width - w;
+		ev[0].dslope = ev[1].dslope = 0;
+		for (j = 0, nev = 2; j < n; j++) {
+			if ((dy = MIN(ys[i] + h, r[j].y + r[j].h) - MAX(ys[i], r[j].y)) <= 0) continue;
+			/* the overlap with r[j] rises from a - w, is flat between min(a, b - w) and max(a, b - w) and falls until b */
+			a = r[j].x;
+			b = r[j].x + r[j].w;
+			ev[nev].pos = a - w;
+			ev[nev++].dslope = dy;
+			ev[nev].pos = MIN(a, b - w);
+			ev[nev++].dslope = -dy;
+			ev[nev].pos = MAX(a, b - w);
+			ev[nev++].dslope = -dy;
+			ev[nev].pos = b;
+			ev[nev++].dslope = dy;
+		}
+		qsort(ev, nev, sizeof(SweepEvent), _cmpsweep);
+		for (j = 0, f = slope = 0, prevpos = ev[0].pos; j < nev; j++) {
+			f += slope * (ev[j].pos - prevpos);
+			prevpos = ev[j].pos;
+			slope += ev[j].dslope;
+			if (ev[j].pos >= m->winarea_x && ev[j].pos <= m->winarea_x + m->winarea_width - w
+					&& (best < 0 || f < best)) {
+				best = f;
+				bestx = ev[j].pos;
+				besty = ys[i];
+				if (best == 0) break;
+			}
+		}
+	}
+	free(r);
+	free(ys);
+	free(ev);
+	c->x = bestx;
+	c->y = besty;
+}
+
+/**
+ * Returns the monitor at a given point, or NULL if the point isn't on any monitor.
+ * 
+ * @param	x	The x coordinate.
+ * @param	y	The y coordinate.
+ */
+Monitor *
+point_to_monitor (int x, int y) {
+	int i, j;
+
+	i = get_lower_bound(monindex.xs, monindex.nx, sizeof(int), x + 1) - 1; /* last edge <= x */
+	j = get_lower_bound(monindex.ys, monindex.ny, sizeof(int), y + 1) - 1;
+	if (i < 0 || j < 0 || i >= monindex.nx - 1 || j >= monindex.ny - 1) {
+		return NULL;
+	}
+	return monindex.cells[j * (monindex.nx - 1) + i];
+}
+
+/**
+ * Brings a client to the top of its monitor's focus stack and gives it focus.
+ * 
+ * @param	c	The client on which to focus.
+ */
+void
+pop (Client *c) {
+	detach(c);
+	attach(c);
+	focus(c);
+	arrange(c->mon);
+}
+
+/**
+ * Steps backward through the client list (starting with the argument c) looking for a tiled client.
+ * 
+ * @param	c The first client to test.
+ */
+Client *
+prev_tiled (Client *c) {
+	Client *p, *r;
+
+	for (p = selmon->clients, r = NULL; p && p != c; p = p->next) {
+		if (!p->isfloating && TAGISVISIBLE(p)) {
+			r = p;
+		}
+	}
+	return r;
+}
+
+/**
+ * Takes a thumbnail of a client into c->thumb, at most preview_width pixels wide and high: the contents of the
+ * window (see preview_redirect) are named with XComposite and scaled down by XRender on the server, without any
+ * round trip for the pixels.
+ * Returns False if the client can't be captured (e.g. it is unmapped or not redirected yet), in which case the
+ * last thumbnail is kept.
+ * 
+ * @param	c	The target client.
+ */
+Bool
+preview_capture (Client *c) {
+#ifdef XCOMPOSITE
+	int w, h, sw, sh;
+	Pixmap named;
+	Picture src, dst;
+	XWindowAttributes wa;
+	XRenderPictureAttributes pa = { .subwindow_mode = IncludeInferiors };
+	XTransform xf = {{{0}}};
+
+	if (!c->redirected || !XGetWindowAttributes(dpy, c->win, &wa) || wa.map_state != IsViewable) return False;
+	sw = wa.width + 2 * wa.border_width;
+	sh = wa.height + 2 * wa.border_width;
+	w = sw >= sh ? (int)preview_width : MAX(1, sw * (int)preview_width / sh);
+	h = sh >= sw ? (int)preview_width : MAX(1, sh * (int)preview_width / sw);
+	if (c->thumb && (c->thumbw != w || c->thumbh != h)) {
+		XFreePixmap(dpy, c->thumb);
+		c->thumb = None;
+	}
+	if (!c->thumb) {
+		c->thumb = XCreatePixmap(dpy, root, w, h, DefaultDepth(dpy, screen));
+		c->thumbw = w;
+		c->thumbh = h;
+	}
+	XSetErrorHandler(_xerrordummy); /* the window may go away any time */
+	named = XCompositeNameWindowPixmap(dpy, c->win);
+	src = XRenderCreatePicture(dpy, named, XRenderFindVisualFormat(dpy, wa.visual), CPSubwindowMode, &pa);
+	dst = XRenderCreatePicture(dpy, c->thumb, XRenderFindVisualFormat(dpy, DefaultVisual(dpy, screen)), 0, NULL);
+	xf.matrix[0][0] = XDoubleToFixed((double)sw / w);
+	xf.matrix[1][1] = XDoubleToFixed((double)sh / h);
+	xf.matrix[2][2] = XDoubleToFixed(1);
+	XRenderSetPictureTransform(dpy, src, &xf);
+	XRenderSetPictureFilter(dpy, src, FilterBilinear, NULL, 0); /* cheap enough for software rendering */
+	XRenderComposite(dpy, PictOpSrc, src, None, dst, 0, 0, 0, 0, 0, 0, w, h);
+	XRenderFreePicture(dpy, src);
+	XRenderFreePicture(dpy, dst);
+	XFreePixmap(dpy, named);
+	XSync(dpy, False);
+	XSetErrorHandler(_xerror);
+	return True;
+#else
+	return False;
+#endif /* XCOMPOSITE */
+}
+
+/**
+ * Closes the preview, if any, and stops refreshing it. The client keeps its last thumbnail, but not its offscreen
+ * pixmap (see preview_unredirect).
+ */
+void
+preview_close (void) {
+	timer_disarm(&previewtimer);
+	if (preview.c) {
+		preview_unredirect(preview.c);
+	}
+	if (preview.win) {
+		XDestroyWindow(dpy, preview.win);
+	}
+	memset(&preview, 0, sizeof preview);
+}
+
+/**
+ * Redirects a client's window offscreen (automatically, so a compositing manager can still do its own thing),
+ * so its contents can be captured by preview_capture even while it is hidden.
+ * Returns True if the window was redirected just now, i.e. its contents aren't there yet.
+ * 
+ * @param	c	The target client.
+ */
+Bool
+preview_redirect (Client *c) {
+#ifdef XCOMPOSITE
+	if (!composite_active || c->redirected) return False;
+	XCompositeRedirectWindow(dpy, c->win, CompositeRedirectAutomatic);
+	c->redirected = True;
+	return True;
+#else
+	return False;
+#endif /* XCOMPOSITE */
+}
+
+/**
+ * Stops redirecting a client's window offscreen once it isn't previewed anymore, so it doesn't keep a pixmap of
+ * its own and a copy on every draw.
+ * 
+ * @param	c	The target client.
+ */
+void
+preview_unredirect (Client *c) {
+#ifdef XCOMPOSITE
+	if (!c->redirected) return;
+	XCompositeUnredirectWindow(dpy, c->win, CompositeRedirectAutomatic);
+	c->redirected = False;
+#endif /* XCOMPOSITE */
+}
+
+/**
+ * Shows the preview of the hovered client: takes a new thumbnail (falling back to the cached one), opens or
+ * resizes the preview window next to the client bar and copies the thumbnail into it.
+ * Refreshes preview_refresh_rate times per second for as long as the preview is shown.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+preview_update (void *unused) {
+	int x, y;
+	Monitor *m = preview.mon;
+	Client *c = preview.c;
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.background_pixmap = None,
+		.event_mask = ExposureMask
+	};
+
+	if (!c) return;
+	if (c->shown) { /* not hidden anymore */
+		preview_close();
+		return;
+	}
+	if (!preview_capture(c) && !c->thumb) {
+		timer_arm(&previewtimer, 1000 / MAX(preview_refresh_rate, 1)); /* maybe it can be captured later */
+		return;
+	}
+	x = MAX(m->winarea_x, MIN(m->winarea_x + preview.x, m->winarea_x + m->winarea_width - c->thumbw - 2));
+	y = m->clientbar_pos < m->mon_y + m->mon_height / 2 ? m->clientbar_pos + th : m->clientbar_pos - c->thumbh - 2;
+	if (!preview.win) {
+		preview.win = XCreateWindow(dpy, root, x, y, c->thumbw, c->thumbh, 1, DefaultDepth(dpy, screen),
+									CopyFromParent, DefaultVisual(dpy, screen),
+									CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+		XSetWindowBorder(dpy, preview.win, scheme[SchemeSel].border->rgb);
+		XMapRaised(dpy, preview.win);
+	} else {
+		XMoveResizeWindow(dpy, preview.win, x, y, c->thumbw, c->thumbh);
+	}
+	XCopyArea(dpy, c->thumb, preview.win, drw->gc, 0, 0, c->thumbw, c->thumbh, 0, 0);
+	if (preview_refresh_rate) {
+		timer_arm(&previewtimer, 1000 / preview_refresh_rate);
+	}
+}
+
+/**
+ * Creates hidden_cgroup if it is configured and gives it its CPU weight. Deprioritized processes are reniced
+ * instead if that fails, e.g. because the cgroup hierarchy isn't delegated to the user, but only if their nice
+ * value can be lowered again afterwards: without privileges, RLIMIT_NICE decides how far that goes.
+ */
+void
+priority_init (void) {
+	char weight[16];
+#ifdef RLIMIT_NICE
+	struct rlimit rl;
+#endif /* RLIMIT_NICE */
+
+	if (!geteuid()) {
+		nice_floor = -20;
+	}
+#ifdef RLIMIT_NICE
+	else if (!getrlimit(RLIMIT_NICE, &rl)) {
+		nice_floor = rl.rlim_cur == RLIM_INFINITY || rl.rlim_cur > 40 ? -20 : 20 - (int)rl.rlim_cur;
+	}
+#endif /* RLIMIT_NICE */
+	if (!hidden_cgroup) return;
+	if (mkdir(hidden_cgroup, 0755) && errno != EEXIST) {
+		fprintf(stderr, "wasdwm: cannot create cgroup %s: %s\n", hidden_cgroup, strerror(errno));
+		return;
+	}
+	snprintf(weight, sizeof weight, "%u", hidden_cpu_weight);
+	hidden_cgroup_ready = priority_write(hidden_cgroup, "cpu.weight", weight);
+}
+
+/**
+ * Deprioritizes a process by moving it into hidden_cgroup, remembering the cgroup it came from, or else by
+ * raising the nice value of all its threads to hidden_nice.
+ * 
+ * @param	p	The target process.
+ */
+void
+priority_lower (ProcPriority *p) {
+	char path[64], line[sizeof p->cgroup + 4];
+	FILE *f;
+
+	p->lowered = True;
+	p->cgroup[0] = '\0';
+	if (hidden_cgroup_ready) {
+		snprintf(path, sizeof path, "/proc/%ld/cgroup", (long)p->pid);
+		if ((f = fopen(path, "r"))) {
+			while (fgets(line, sizeof line, f)) {
+				if (!strncmp(line, "0::", 3)) { /* the cgroup v2 hierarchy */
+					line[strcspn(line, "\n")] = '\0';
+					if (snprintf(p->cgroup, sizeof p->cgroup, "/sys/fs/cgroup%s", line + 3) >= sizeof p->cgroup) {
+						p->cgroup[0] = '\0'; /* too long to move it back */
+					}
+				}
+			}
+			fclose(f);
+		}
+		snprintf(path, sizeof path, "%ld", (long)p->pid);
+		if (p->cgroup[0] && priority_write(hidden_cgroup, "cgroup.procs", path)) return;
+		p->cgroup[0] = '\0';
+	}
+	errno = 0;
+	p->nice = getpriority(PRIO_PROCESS, p->pid);
+	if ((p->nice == -1 && errno) || p->nice >= hidden_nice || p->nice < nice_floor
+			|| !priority_set_nice(p->pid, hidden_nice)) {
+		p->lowered = False; /* gone, not ours, already low enough, or it couldn't be restored */
+	}
+}
+
+/**
+ * Gives a deprioritized process its priority back, unless it has exited in the meantime.
+ * 
+ * @param	p	The target process.
+ */
+void
+priority_restore (ProcPriority *p) {
+	char pid[16];
+	Bool ok;
+
+	if (!p->lowered) return;
+	if (kill(p->pid, 0) && errno == ESRCH) { /* it exited, nothing to give back */
+		p->lowered = False;
+		return;
+	}
+	if (p->cgroup[0]) {
+		snprintf(pid, sizeof pid, "%ld", (long)p->pid);
+		ok = priority_write(p->cgroup, "cgroup.procs", pid);
+	} else {
+		ok = priority_set_nice(p->pid, p->nice);
+	}
+	if (!ok) { /* stays lowered, it is tried again on the next update */
+		fprintf(stderr, "wasdwm: cannot restore the priority of process %ld: %s\n", (long)p->pid, strerror(errno));
+		return;
+	}
+	p->lowered = False;
+}
+
+/**
+ * Sets the nice value of a process. On Linux, nice values belong to threads, so it is set for each of them.
+ * 
+ * @param	pid		The target process.
+ * @param	nice	The new nice value.
+ */
+Bool
+priority_set_nice (pid_t pid, int nice) {
+	Bool ok = False;
+#ifdef __linux__
+	char path[64];
+	DIR *dp;
+	struct dirent *de;
+
+	snprintf(path, sizeof path, "/proc/%ld/task", (long)pid);
+	if ((dp = opendir(path))) {
+		while ((de = readdir(dp))) {
+			if (de->d_name[0] != '.' && !setpriority(PRIO_PROCESS, atoi(de->d_name), nice)) {
+				ok = True;
+			}
+		}
+		closedir(dp);
+		return ok;
+	}
+#endif /* __linux__ */
+	ok = !setpriority(PRIO_PROCESS, pid, nice);
+	return ok;
+}
+
+/**
+ * Writes a short text to a cgroup control file.
+ * 
+ * @param	dir		The cgroup directory.
+ * @param	file	The name of the control file.
+ * @param	text	The text to write.
+ */
+Bool
+priority_write (const char *dir, const char *file, const char *text) {
+	char path[512];
+	int fd;
+	Bool ok;
+
+	snprintf(path, sizeof path, "%s/%s", dir, file);
+	if ((fd = open(path, O_WRONLY|O_CLOEXEC)) < 0) return False;
+	ok = write(fd, text, strlen(text)) == (ssize_t)strlen(text);
+	close(fd);
+	return ok;
+}
+
+/**
+ * Counts events towards a per-second rate.
+ * 
+ * @param	r	The target rate.
+ * @param	n	The number of events.
+ */
+void
+rate_add (Rate *r, unsigned int n) {
+	rate_get(r);
+	r->count += n;
+}
+
+/**
+ * Returns the number of events counted during the last full second.
+ * 
+ * @param	r	The target rate.
+ */
+unsigned int
+rate_get (Rate *r) {
+	long long now = get_time_ms();
+
+	if (now - r->start >= 2000) {
+		r->last = 0;
+		r->count = 0;
+		r->start = now;
+	} else if (now - r->start >= 1000) {
+		r->last = r->count;
+		r->count = 0;
+		r->start += 1000;
+	}
+	return r->last;
+}
+
+/**
+ * Returns the monitor associated with a rectangular region.
  */
 Monitor *
 rect_to_monitor (int x, int y, int w, int h) {
 	Monitor *m, *r = selmon;
-	int a, area = 0;
-
-	for (m = mons; m; m = m->next) {
-		if ((a = INTERSECT(x, y, w, h, m)) > area) {
-			area = a;
-			r = m;
+	int i, j, x0, x1, y0, y1, a, area = 0;
+
+	if (w <= 1 && h <= 1) {
+		return (m = point_to_monitor(x, y)) ? m : selmon;
+	}
+	/* only the monitors covering the cells the rectangle touches are candidates */
+	x0 = MAX(get_lower_bound(monindex.xs, monindex.nx, sizeof(int), x + 1) - 1, 0);
+	x1 = MIN(get_lower_bound(monindex.xs, monindex.nx, sizeof(int), x + w), monindex.nx - 1);
+	y0 = MAX(get_lower_bound(monindex.ys, monindex.ny, sizeof(int), y + 1) - 1, 0);
+	y1 = MIN(get_lower_bound(monindex.ys, monindex.ny, sizeof(int), y + h), monindex.ny - 1);
+	for (j = y0; j < y1; j++) {
+		for (i = x0; i < x1; i++) {
+			if ((m = monindex.cells[j * (monindex.nx - 1) + i]) && (a = INTERSECT(x, y, w, h, m)) > area) {
+				area = a;
+				r = m;
+			}
 		}
 	}
 	return r;
 }
+
+/**
+ * Refreshes a client's title and redraws the bars that show it.
+ * 
+ * @param	arg	The target client.
+ */
+void
+refresh_title (void *arg) {
+	Client *c = (Client *)arg;
+
+	c->titletime = get_time_ms();
+	update_title(c);
+	if (c == c->mon->sel) {
+		draw_tagbar(c->mon);
+	}
+	draw_clientbar(c->mon);
+}
  
 /**
  * Resizes a client, applying size hints first.
@@ -2508,8 +4960,13 @@ resize_client (Client *c, int x, int y, int w, int h) {
 	c->oldw = c->w; c->w = wc.width = w;
 	c->oldh = c->h; c->h = wc.height = h;
 	wc.border_width = c->bw;
+	if (staging) { /* final size, but still hidden */
+		wc.x = WIDTH(c) * -2;
+	}
 	XConfigureWindow(dpy, c->win, CWX|CWY|CWWidth|CWHeight|CWBorderWidth, &wc);
+	c->shown = !staging;
 	configure(c);
+	snap_index_update(c);
 	XSync(dpy, False);
 }
 
@@ -2524,6 +4981,10 @@ restack (Monitor *m) {
 	XEvent ev;
 	XWindowChanges wc;
 
+	if (batching) {
+		m->deferred |= DeferRestack;
+		return;
+	}
 	draw_tagbar(m);
 	draw_clientbar(m);
 	if (!m->sel) return;
@@ -2541,42 +5002,554 @@ restack (Monitor *m) {
 			}
 		}
 	}
-	XSync(dpy, False);
-	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	XSync(dpy, False);
+	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+}
+
+/**
+ * Takes over the clients saved by a previous process (see save_state) and removes them from a list of windows.
+ * The saved state replaces the rules and the window properties, so the windows aren't queried at all
+ * and every monitor is arranged only once.
+ * 
+ * @param	wins	The children of the root window, restored windows are set to None.
+ * @param	num		The length of wins.
+ */
+Bool
+restore_state (Window *wins, unsigned int num) {
+	int i, j, format;
+	unsigned int nrestored = 0;
+	unsigned long n, extra;
+	unsigned char *p = NULL;
+	Atom type;
+	Window *present, *restored;
+	StateHeader *hdr;
+	MonitorState *ms;
+	ClientState *cs;
+	TagState *st;
+	Client *c, **bystack;
+	Monitor *m;
+
+	if (XGetWindowProperty(dpy, root, wasdwmatom[WasdwmState], 0, 0x7fffffff, True, wasdwmatom[WasdwmState],
+			&type, &format, &n, &extra, &p) != Success || !p) {
+		return False;
+	}
+	hdr = (StateHeader *)p;
+	if (format != 8 || n < sizeof(StateHeader) || hdr->magic != STATE_MAGIC
+			|| hdr->size != sizeof(StateHeader) + sizeof(MonitorState) + sizeof(ClientState)
+			|| hdr->nmons < 0 || hdr->nclients < 0
+			|| n != sizeof(StateHeader) + hdr->nmons * sizeof(MonitorState) + hdr->nclients * sizeof(ClientState)) {
+		XFree(p);
+		return False;
+	}
+	ms = (MonitorState *)(hdr + 1);
+	cs = (ClientState *)(ms + hdr->nmons);
+	if (!(bystack = calloc(hdr->nclients + 1, sizeof(Client *)))
+			|| !(present = malloc((num + 1) * sizeof(Window)))
+			|| !(restored = malloc((hdr->nclients + 1) * sizeof(Window)))) {
+		die("fatal: could not malloc() %u bytes\n", (num + hdr->nclients + 1) * sizeof(Window));
+	}
+	for (i = 0; i < hdr->nclients; i++) {
+		if (cs[i].stackpos < 0 || cs[i].stackpos >= hdr->nclients) {
+			free(bystack);
+			free(present);
+			free(restored);
+			XFree(p);
+			return False;
+		}
+	}
+	/* windows that went away in the meantime are skipped */
+	memcpy(present, wins, num * sizeof(Window));
+	qsort(present, num, sizeof(Window), _cmpwin);
+
+	/* tags */
+	if (!tagset_empty(&hdr->tagmask)) {
+		tagmask = hdr->tagmask;
+		memcpy(tagnames, hdr->tagnames, sizeof tagnames);
+		for (i = 0; i < MAXTAGS; i++) {
+			tagnames[i][TAGNAMELEN - 1] = '\0';
+		}
+		for (numtags = MAXTAGS; !TAGSET_HAS(tagmask, numtags - 1); numtags--);
+	}
+
+	/* monitors */
+	for (m = mons; m; m = m->next) {
+		for (i = 0; i < hdr->nmons && ms[i].num != m->num; i++);
+		if (i == hdr->nmons) continue;
+		m->marked_width = ms[i].marked_width;
+		m->selected_tags = ms[i].selected_tags & 1;
+		m->selected_layout = ms[i].selected_layout & 1;
+		for (j = 0; j < 2; j++) {
+			m->tagset[j] = ms[i].tagset[j];
+			tagset_and(&m->tagset[j], &tagmask);
+			if (tagset_empty(&m->tagset[j])) {
+				TAGSET_ADD(m->tagset[j], tagset_first(&tagmask));
+			}
+		}
+		m->layout[0] = &layouts[ms[i].layout[0] % LENGTH(layouts)];
+		m->layout[1] = &layouts[ms[i].layout[1] % LENGTH(layouts)];
+		m->show_clientbar = ms[i].show_clientbar;
+		m->show_tagbar = ms[i].show_tagbar;
+		m->tags_on_top = ms[i].tags_on_top;
+		m->pertag->curtag = ms[i].curtag % (MAXTAGS + 1);
+		m->pertag->prevtag = ms[i].prevtag % (MAXTAGS + 1);
+		for (j = 0; j <= MAXTAGS; j++) {
+			if (!ms[i].pertag[j]) continue;
+			st = get_tag_state(m, j);
+			st->marked_width = ms[i].marked_widths[j];
+			st->selected_layout = ms[i].selected_layouts[j] & 1;
+			st->layoutidxs[0] = &layouts[ms[i].layoutidxs[j][0] % LENGTH(layouts)];
+			st->layoutidxs[1] = &layouts[ms[i].layoutidxs[j][1] % LENGTH(layouts)];
+			st->show_tagbar = ms[i].show_tagbars[j];
+		}
+		if (hdr->selmon == m->num) {
+			selmon = m;
+		}
+	}
+
+	/* clients, in reverse so prepending them recreates the saved list order */
+	for (i = hdr->nclients - 1; i >= 0; i--) {
+		if (!bsearch(&cs[i].win, present, num, sizeof(Window), _cmpwin)) continue;
+		if (!(c = calloc(1, sizeof(Client)))) {
+			die("fatal: could not malloc() %u bytes\n", sizeof(Client));
+		}
+		for (m = mons; m && m->num != cs[i].mon; m = m->next);
+		c->mon = m ? m : mons;
+		c->win = cs[i].win;
+		c->tags = cs[i].tags;
+		c->scratchpad = cs[i].scratchpad > 0 && cs[i].scratchpad <= LENGTH(scratchpads) ? cs[i].scratchpad : 0;
+		tagset_and(&c->tags, &tagmask);
+		if (tagset_empty(&c->tags) && !c->scratchpad) {
+			c->tags = c->mon->tagset[c->mon->selected_tags];
+		}
+		c->x = cs[i].x; c->y = cs[i].y; c->w = cs[i].w; c->h = cs[i].h;
+		c->oldx = cs[i].oldx; c->oldy = cs[i].oldy; c->oldw = cs[i].oldw; c->oldh = cs[i].oldh;
+		c->bw = cs[i].bw; c->oldbw = cs[i].oldbw;
+		c->basew = cs[i].basew; c->baseh = cs[i].baseh;
+		c->incw = cs[i].incw; c->inch = cs[i].inch;
+		c->maxw = cs[i].maxw; c->maxh = cs[i].maxh;
+		c->minw = cs[i].minw; c->minh = cs[i].minh;
+		c->mina = cs[i].mina; c->maxa = cs[i].maxa;
+		c->hintflags = cs[i].hintflags;
+		c->wasfloating = cs[i].wasfloating;
+		c->isfixed = cs[i].isfixed;
+		c->isfloating = cs[i].isfloating;
+		c->isurgent = cs[i].isurgent;
+		c->neverfocus = cs[i].neverfocus;
+		c->oldstate = cs[i].oldstate;
+		c->isfullscreen = cs[i].isfullscreen;
+		c->minimized = cs[i].minimized;
+		c->marked = cs[i].marked;
+		c->outline = cs[i].outline;
+		c->deprioritize = cs[i].deprioritize;
+		c->pid = cs[i].pid;
+		c->onscreen = True;
+		memcpy(c->name, cs[i].name, sizeof c->name);
+		c->name[sizeof c->name - 1] = '\0';
+		memcpy(c->class, cs[i].class, sizeof c->class);
+		c->class[sizeof c->class - 1] = '\0';
+		c->titletimer.func = refresh_title;
+		c->titletimer.arg = c;
+		c->next = c->mon->clients;
+		c->mon->clients = c;
+		if (bystack[cs[i].stackpos]) { /* shouldn't happen, the bottom of the stack will do */
+			stack_attach(c);
+		} else {
+			bystack[cs[i].stackpos] = c;
+		}
+		restored[nrestored++] = c->win;
+		for (j = 0; j < hdr->nmons; j++) {
+			if (ms[j].num == c->mon->num && ms[j].sel == c->win) {
+				c->mon->sel = c;
+			}
+		}
+		snap_index_update(c);
+		XSelectInput(dpy, c->win, EnterWindowMask|FocusChangeMask|PropertyChangeMask|StructureNotifyMask);
+		grab_buttons(c, False);
+	}
+	for (i = hdr->nclients - 1; i >= 0; i--) {
+		if ((c = bystack[i])) {
+			c->snext = c->mon->stack;
+			c->mon->stack = c;
+		}
+	}
+	XFree(p);
+
+	/* leave the windows that weren't known to the previous process to scan() */
+	qsort(restored, nrestored, sizeof(Window), _cmpwin);
+	for (i = 0; i < num; i++) {
+		if (bsearch(&wins[i], restored, nrestored, sizeof(Window), _cmpwin)) {
+			wins[i] = None;
+		}
+	}
+	free(bystack);
+	free(present);
+	free(restored);
+
+	update_client_list();
+	for (m = mons; m; m = m->next) {
+		if (m != selmon) {
+			arrange(m);
+			restack(m);
+		}
+	}
+	focus(selmon->sel); /* arranges selmon */
+	restack(selmon);
+	for (m = mons; m; m = m->next) {
+		XMoveResizeWindow(dpy, m->tagbar_win, m->winarea_x, m->tagbar_pos, m->winarea_width, bh);
+	}
+	return True;
+}
+
+/**
+ * Runs a sequence of commands, deferring the arrange(), restack() and bar drawing they cause until the last
+ * one is done. Each affected monitor is then arranged, restacked and drawn at most once.
+ * 
+ * @param	actions	The commands to run.
+ * @param	n		The number of commands, or -1 if the array is terminated by an Action without a function.
+ */
+void
+run_actions (const Action *actions, int n) {
+	int i;
+	Monitor *m;
+
+	batching++;
+	for (i = 0; n < 0 ? actions[i].func != NULL : i < n; i++) {
+		if (actions[i].func) {
+			actions[i].func(&actions[i].arg);
+		}
+	}
+	if (--batching > 0 || !running) return;
+
+	for (m = mons; m; m = m->next) {
+		if (m->deferred & DeferArrange) {
+			m->deferred &= ~DeferArrange;
+			arrange(m);
+		}
+	}
+	for (m = mons; m; m = m->next) {
+		if (m->deferred & DeferRestack) {
+			m->deferred &= ~DeferRestack;
+			restack(m);	/* also draws the bars */
+		}
+	}
+	for (m = mons; m; m = m->next) {
+		if (m->deferred & DeferDraw) {
+			m->deferred &= ~DeferDraw;
+			draw_tagbar(m);
+			draw_clientbar(m);
+		}
+	}
+}
+
+/**
+ * Runs the commands in a string as one macro (see run_actions). Commands are separated by ';' and consist of a
+ * name from ipc_commands, optionally followed by an argument: a number, a layout index, a string, or for tag
+ * commands a tag index, a tag name, "all" or "prev". For example: "tag_client 3; view_tag 3; set_layout 2".
+ * 
+ * @param	cmds	The command string, modified in place.
+ */
+void
+run_command_string (char *cmds) {
+	int i, n = 0;
+	char *cmd, *next, *param;
+	Action actions[MAXACTIONS];
+
+	for (cmd = cmds; cmd && n < MAXACTIONS; cmd = next) {
+		if ((next = strchr(cmd, ';'))) {
+			*next++ = '\0';
+		}
+		cmd += strspn(cmd, " \t\n");
+		param = cmd + strcspn(cmd, " \t\n");
+		if (*param) {
+			*param++ = '\0';
+			param += strspn(param, " \t\n");
+			for (i = strlen(param); i > 0 && strchr(" \t\n", param[i - 1]); param[--i] = '\0');
+		}
+		for (i = 0; i < LENGTH(ipc_commands) && strcmp(cmd, ipc_commands[i].name); i++);
+		if (i == LENGTH(ipc_commands)) {
+			if (*cmd) {
+				fprintf(stderr, "wasdwm: unknown command '%s'\n", cmd);
+			}
+			continue;
+		}
+		memset(&actions[n].arg, 0, sizeof actions[n].arg);
+		actions[n].func = ipc_commands[i].func;
+		switch (ipc_commands[i].argtype) {
+			case ArgInt:
+				actions[n].arg.i = atoi(param);
+				break;
+			case ArgFloat:
+				actions[n].arg.f = atof(param);
+				break;
+			case ArgLayout:
+				if (*param) {
+					actions[n].arg.v = &layouts[atoi(param) % LENGTH(layouts)];
+				}
+				break;
+			case ArgString:
+				actions[n].arg.v = *param ? param : NULL;
+				break;
+			case ArgTag:
+				if (!strcmp(param, "all")) {
+					actions[n].arg.i = ALLTAGS;
+				} else if (!strcmp(param, "prev")) {
+					actions[n].arg.i = PREVTAGS;
+				} else {
+					for (i = 0; i < numtags && !(TAGSET_HAS(tagmask, i) && !strcmp(param, tagnames[i])); i++);
+					if (i < numtags) {
+						actions[n].arg.i = i;
+					} else if (*param && !param[strspn(param, "0123456789")]) {
+						actions[n].arg.i = atoi(param);
+					} else {
+						fprintf(stderr, "wasdwm: unknown tag '%s'\n", param);
+						continue;
+					}
+				}
+				break;
+		}
+		n++;
+	}
+	run_actions(actions, n);
+}
+
+/**
+ * Calls the functions of all timers that are due.
+ */
+void
+run_timers (void) {
+	long long now = get_time_ms();
+	Timer *t;
+
+	while ((t = timers) && t->due <= now) {
+		timers = t->next;
+		t->armed = False;
+		t->func(t->arg);
+	}
+}
+
+/**
+ * Saves the state of all monitors and clients in the _WASDWM_STATE property of the root window,
+ * to be picked up by restore_state after a restart.
+ */
+void
+save_state (void) {
+	int i, j, nmons = 0, nclients = 0, pos = 0;
+	size_t size;
+	unsigned char *buf;
+	StateHeader *hdr;
+	MonitorState *ms;
+	ClientState *cs, *first;
+	TagState *st;
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next, nmons++) {
+		for (c = m->clients; c; c = c->next, nclients++);
+	}
+	size = sizeof(StateHeader) + nmons * sizeof(MonitorState) + nclients * sizeof(ClientState);
+	if (!(buf = calloc(1, size))) {
+		die("fatal: could not malloc() %u bytes\n", size);
+	}
+	hdr = (StateHeader *)buf;
+	hdr->magic = STATE_MAGIC;
+	hdr->size = sizeof(StateHeader) + sizeof(MonitorState) + sizeof(ClientState);
+	hdr->nmons = nmons;
+	hdr->nclients = nclients;
+	hdr->selmon = selmon->num;
+	hdr->tagmask = tagmask;
+	memcpy(hdr->tagnames, tagnames, sizeof tagnames);
+	ms = (MonitorState *)(hdr + 1);
+	cs = (ClientState *)(ms + nmons);
+	for (m = mons; m; m = m->next, ms++) {
+		ms->num = m->num;
+		ms->sel = m->sel ? m->sel->win : None;
+		ms->marked_width = m->marked_width;
+		ms->selected_tags = m->selected_tags;
+		ms->selected_layout = m->selected_layout;
+		ms->tagset[0] = m->tagset[0];
+		ms->tagset[1] = m->tagset[1];
+		ms->layout[0] = m->layout[0] - layouts;
+		ms->layout[1] = m->layout[1] - layouts;
+		ms->show_clientbar = m->show_clientbar;
+		ms->show_tagbar = m->show_tagbar;
+		ms->tags_on_top = m->tags_on_top;
+		ms->curtag = m->pertag->curtag;
+		ms->prevtag = m->pertag->prevtag;
+		for (i = 0; i <= MAXTAGS; i++) {
+			if (!(st = m->pertag->tags[i])) continue;
+			ms->pertag[i] = True;
+			ms->marked_widths[i] = st->marked_width;
+			ms->selected_layouts[i] = st->selected_layout;
+			ms->layoutidxs[i][0] = st->layoutidxs[0] - layouts;
+			ms->layoutidxs[i][1] = st->layoutidxs[1] - layouts;
+			ms->show_tagbars[i] = st->show_tagbar;
+		}
+		for (first = cs, c = m->clients; c; c = c->next, cs++) {
+			cs->win = c->win;
+			cs->mon = m->num;
+			cs->tags = c->tags;
+			cs->x = c->x; cs->y = c->y; cs->w = c->w; cs->h = c->h;
+			cs->oldx = c->oldx; cs->oldy = c->oldy; cs->oldw = c->oldw; cs->oldh = c->oldh;
+			cs->bw = c->bw; cs->oldbw = c->oldbw;
+			cs->basew = c->basew; cs->baseh = c->baseh;
+			cs->incw = c->incw; cs->inch = c->inch;
+			cs->maxw = c->maxw; cs->maxh = c->maxh;
+			cs->minw = c->minw; cs->minh = c->minh;
+			cs->mina = c->mina; cs->maxa = c->maxa;
+			cs->hintflags = c->hintflags;
+			cs->wasfloating = c->wasfloating;
+			cs->isfixed = c->isfixed;
+			cs->isfloating = c->isfloating;
+			cs->isurgent = c->isurgent;
+			cs->neverfocus = c->neverfocus;
+			cs->oldstate = c->oldstate;
+			cs->isfullscreen = c->isfullscreen;
+			cs->minimized = c->minimized;
+			cs->marked = c->marked;
+			cs->outline = c->outline;
+			cs->scratchpad = c->scratchpad;
+			cs->deprioritize = c->deprioritize;
+			cs->pid = c->pid;
+			memcpy(cs->name, c->name, sizeof cs->name);
+			memcpy(cs->class, c->class, sizeof cs->class);
+		}
+		/* stack positions are numbered across all monitors */
+		for (c = m->stack; c; c = c->snext, pos++) {
+			for (i = 0, j = cs - first; i < j && first[i].win != c->win; i++);
+			if (i < j) {
+				first[i].stackpos = pos;
+			}
+		}
+	}
+	XChangeProperty(dpy, root, wasdwmatom[WasdwmState], wasdwmatom[WasdwmState], 8,
+			PropModeReplace, buf, size);
+	free(buf);
+}
+
+/**
+ * Scans for preexisting windows to manage.
+ * Windows handed over by a previous process (see cmd_restart) are taken over as they were.
+ */
+void
+scan (void) {
+	unsigned int i, num;
+	Window d1, d2, *wins = NULL;
+	XWindowAttributes wa;
+
+	if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
+		restore_state(wins, num);
+		for (i = 0; i < num; i++) {
+			if (wins[i] == None) continue;
+			if (!XGetWindowAttributes(dpy, wins[i], &wa)
+					|| wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1)) {
+				continue;
+			}
+			if (wa.map_state == IsViewable || get_state(wins[i]) == IconicState) {
+				manage(wins[i], &wa);
+			}
+		}
+		for (i = 0; i < num; i++) { /* now the transients */
+			if (wins[i] == None || !XGetWindowAttributes(dpy, wins[i], &wa)) continue;
+			if (XGetTransientForHint(dpy, wins[i], &d1)
+					&& (wa.map_state == IsViewable || get_state(wins[i]) == IconicState)) {
+				manage(wins[i], &wa);
+			}
+		}
+		if (wins) {
+			XFree(wins);
+		}
+	}
+}
+
+/**
+ * Makes sure update_priorities looks at the clients' visibility once the pending events are handled.
+ */
+void
+schedule_priority_update (void) {
+	if (!priotimer.armed || priotimer.due > get_time_ms()) {
+		timer_arm(&priotimer, 0);
+	}
+}
+
+/**
+ * Makes sure the _WASDWM_STATS property gets refreshed soon.
+ * Updates are rate limited to one per second.
+ */
+void
+schedule_stats_update (void) {
+	if (!statstimer.armed) {
+		timer_arm(&statstimer, 1000);
+	}
+}
+
+/**
+ * Refreshes a client's title, at most title_refresh_rate times per second.
+ * Changes that come in faster are collapsed into a single refresh once the interval has passed,
+ * which reads whatever the title is at that point.
+ * 
+ * @param	c	The target client.
+ */
+void
+schedule_title_update (Client *c) {
+	long long elapsed = get_time_ms() - c->titletime;
+	int interval = 1000 / MAX(title_refresh_rate, 1);
+
+	if (c->titletimer.armed) return; /* the pending refresh will pick up this change */
+
+	if (elapsed >= interval) {
+		refresh_title(c);
+	} else {
+		timer_arm(&c->titletimer, interval - elapsed);
+	}
+}
+
+/**
+ * Finds the client of a scratchpad, if its window exists.
+ * 
+ * @param	i	The index of the scratchpad (see config.h).
+ */
+Client *
+scratchpad_client (int i) {
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = c->next) {
+			if (c->scratchpad == i + 1) {
+				return c;
+			}
+		}
+	}
+	return NULL;
 }
 
 /**
- * Scans for preexisting windows to manage.
+ * Spawns the scratchpads configured to be ready at startup, unless their windows survived a restart.
  */
 void
-scan (void) {
-	unsigned int i, num;
-	Window d1, d2, *wins = NULL;
-	XWindowAttributes wa;
+scratchpad_prespawn (void) {
+	unsigned int i;
 
-	if (XQueryTree(dpy, root, &d1, &d2, &wins, &num)) {
-		for (i = 0; i < num; i++) {
-			if (!XGetWindowAttributes(dpy, wins[i], &wa)
-					|| wa.override_redirect || XGetTransientForHint(dpy, wins[i], &d1)) {
-				continue;
-			}
-			if (wa.map_state == IsViewable || get_state(wins[i]) == IconicState) {
-				manage(wins[i], &wa);
-			}
-		}
-		for (i = 0; i < num; i++) { /* now the transients */
-			if (!XGetWindowAttributes(dpy, wins[i], &wa)) continue;
-			if (XGetTransientForHint(dpy, wins[i], &d1)
-					&& (wa.map_state == IsViewable || get_state(wins[i]) == IconicState)) {
-				manage(wins[i], &wa);
-			}
-		}
-		if (wins) {
-			XFree(wins);
+	for (i = 0; i < LENGTH(scratchpads); i++) {
+		if (scratchpads[i].prespawn && !scratchpad_client(i)) {
+			scratchpad_spawn(i);
 		}
 	}
 }
 
+/**
+ * Spawns a scratchpad's command. Its window is kept hidden when it appears, unless it was summoned in the meantime.
+ * 
+ * @param	i	The index of the scratchpad (see config.h).
+ */
+void
+scratchpad_spawn (int i) {
+	Arg a = { .v = scratchpads[i].cmd };
+
+	scratchtime[i] = get_time_ms();
+	cmd_spawn(&a);
+}
+
 /**
  * Sends a client to a given monitor.
  * 
@@ -2585,15 +5558,18 @@ scan (void) {
  */
 void
 send_client_to_monitor (Client *c, Monitor *m) {
+	c->homemon = None; /* the user decides where it lives now */
 	if (c->mon == m) return;
 	unfocus(c);
 	focus_root();
+	clear_tag_selection(c);
 	detach(c);
 	stack_detach(c);
 	c->mon = m;
 	c->tags = m->tagset[m->selected_tags]; /* assign tags of target monitor */
 	attach(c);
 	stack_attach(c);
+	snap_index_update(c);
 	focus(NULL);
 	arrange(NULL);
 }
@@ -2634,39 +5610,61 @@ send_event (Client *c, Atom proto) {
  */
 void
 setup (void) {
+	unsigned int i;
+	Monitor *m;
 	XSetWindowAttributes wa;
+#if defined(XRANDR) || defined(XCOMPOSITE)
+	int major, minor, errbase;
+#endif /* XRANDR || XCOMPOSITE */
 
 	/* clean up any zombies immediately */
 	sigchld(0);
+	/* keep the X connection out of spawned processes */
+	fcntl(ConnectionNumber(dpy), F_SETFD, FD_CLOEXEC);
 
 	/* init screen */
 	screen = DefaultScreen(dpy);
 	root = RootWindow(dpy, screen);
 	fnt = font_create(dpy, font);
+	log_startup_phase("font");
 	sw = DisplayWidth(dpy, screen);
 	sh = DisplayHeight(dpy, screen);
 	bh = fnt->h + 2;
+	iconsize = MAX(bh - 4, 1);
 	th = bh;
 	drw = gfx_create(dpy, screen, root, sw, sh);
 	gfx_set_font(drw, fnt);
+	/* init tags */
+	for (i = 0; i < LENGTH(tags); i++) {
+		snprintf(tagnames[i], TAGNAMELEN, "%s", tags[i]);
+		TAGSET_ADD(tagmask, i);
+	}
+	numtags = LENGTH(tags);
+#ifdef XRANDR
+	if (XRRQueryExtension(dpy, &randr_event_base, &errbase) && XRRQueryVersion(dpy, &major, &minor)
+			&& (major > 1 || (major == 1 && minor >= 5))) {
+		randr_active = True;
+		XRRSelectInput(dpy, root, RRScreenChangeNotifyMask|RRCrtcChangeNotifyMask|RROutputChangeNotifyMask);
+	}
+#endif /* XRANDR */
+#ifdef XRES
+	xres_active = XResQueryExtension(dpy, &xres_event_base, &xres_error_base);
+#endif /* XRES */
+#ifdef XCOMPOSITE
+	if (XCompositeQueryExtension(dpy, &major, &errbase) && XCompositeQueryVersion(dpy, &major, &minor)
+			&& (major > 0 || minor >= 2) && XRenderQueryExtension(dpy, &major, &errbase)) {
+		composite_active = True;
+	}
+#endif /* XCOMPOSITE */
 	update_geometry();
-	/* init atoms */
-	wmatom[WMProtocols] = XInternAtom(dpy, "WM_PROTOCOLS", False);
-	wmatom[WMDelete] = XInternAtom(dpy, "WM_DELETE_WINDOW", False);
-	wmatom[WMState] = XInternAtom(dpy, "WM_STATE", False);
-	wmatom[WMTakeFocus] = XInternAtom(dpy, "WM_TAKE_FOCUS", False);
-	netatom[NetActiveWindow] = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
-	netatom[NetSupported] = XInternAtom(dpy, "_NET_SUPPORTED", False);
-	netatom[NetWMName] = XInternAtom(dpy, "_NET_WM_NAME", False);
-	netatom[NetWMState] = XInternAtom(dpy, "_NET_WM_STATE", False);
-	netatom[NetWMFullscreen] = XInternAtom(dpy, "_NET_WM_STATE_FULLSCREEN", False);
-	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
-	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
-	netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+	log_startup_phase("geometry");
+	intern_atoms();
+	log_startup_phase("atoms");
 	/* init cursors */
 	cursor[CursorNormal] = XCreateFontCursor(drw->dpy, XC_left_ptr);
 	cursor[CursorResize] = XCreateFontCursor(drw->dpy, XC_sizing);
 	cursor[CursorMove] = XCreateFontCursor(drw->dpy, XC_fleur);
+	log_startup_phase("cursors");
 	/* init appearance */
 	scheme[SchemeNorm].border = color_create(drw, normbordercolor);
 	scheme[SchemeNorm].bg = color_create(drw, normbgcolor);
@@ -2683,20 +5681,39 @@ setup (void) {
 	scheme[SchemeUrgent].border = color_create(drw, urgentbordercolor);
 	scheme[SchemeUrgent].bg = color_create(drw, urgentbgcolor);
 	scheme[SchemeUrgent].fg = color_create(drw, urgentfgcolor);
+	log_startup_phase("colors");
 	/* init bars */
 	init_bars();
 	update_statusarea();
+	for (m = mons; m; m = m->next) {
+		m->dirty = False;
+	}
+	log_startup_phase("bars");
+	/* supporting window for EWMH compliance, it also carries the statistics */
+	wmcheckwin = XCreateSimpleWindow(dpy, root, 0, 0, 1, 1, 0, 0, 0);
+	XChangeProperty(dpy, wmcheckwin, netatom[NetWMCheck], XA_WINDOW, 32,
+			PropModeReplace, (unsigned char *) &wmcheckwin, 1);
+	XChangeProperty(dpy, wmcheckwin, netatom[NetWMName], utf8string, 8,
+			PropModeReplace, (unsigned char *) "wasdwm", 6);
+	XChangeProperty(dpy, root, netatom[NetWMCheck], XA_WINDOW, 32,
+			PropModeReplace, (unsigned char *) &wmcheckwin, 1);
 	/* EWMH support per view */
 	XChangeProperty(dpy, root, netatom[NetSupported], XA_ATOM, 32,
 			PropModeReplace, (unsigned char *) netatom, NetLast);
 	XDeleteProperty(dpy, root, netatom[NetClientList]);
 	/* select for events */
 	wa.cursor = cursor[CursorNormal];
-	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask|PointerMotionMask
+	wa.event_mask = SubstructureRedirectMask|SubstructureNotifyMask|ButtonPressMask
 					|EnterWindowMask|LeaveWindowMask|StructureNotifyMask|PropertyChangeMask;
 	XChangeWindowAttributes(dpy, root, CWEventMask|CWCursor, &wa);
 	XSelectInput(dpy, root, wa.event_mask);
+	chord_build();
 	grab_shortcut_keys();
+	path_index_init();
+	priority_init();
+	if (resource_sample_interval) {
+		timer_arm(&resourcetimer, resource_sample_interval);
+	}
 	focus(NULL);
 }
 
@@ -2710,6 +5727,8 @@ void
 set_client_state (Client *c, long state) {
 	long data[] = { state, None };
 
+	if (c->wmstate == state) return;
+	c->wmstate = state;
 	XChangeProperty(dpy, c->win, wmatom[WMState], wmatom[WMState], 32,
 			PropModeReplace, (unsigned char *)data, 2);
 }
@@ -2760,6 +5779,149 @@ sigchld (int unused) {
 	while (0 < waitpid(-1, NULL, WNOHANG));
 }
 
+/**
+ * Removes a client's edges from the snapping index they were recorded in.
+ * 
+ * @param	c	The target client.
+ */
+void
+snap_index_remove (Client *c) {
+	Monitor *m = c->snapmon;
+
+	if (!m) return;
+	edge_index_remove(&m->xedges, c->snapx, c);
+	edge_index_remove(&m->xedges, c->snapx + c->snapw, c);
+	edge_index_remove(&m->yedges, c->snapy, c);
+	edge_index_remove(&m->yedges, c->snapy + c->snaph, c);
+	c->snapmon = NULL;
+}
+
+/**
+ * Brings a client's entry in its monitor's snapping index up to date.
+ * Only floating (non-fullscreen) clients are indexed.
+ * 
+ * @param	c	The target client.
+ */
+void
+snap_index_update (Client *c) {
+	if (c->snapmon == c->mon && c->snapx == c->x && c->snapy == c->y
+			&& c->snapw == WIDTH(c) && c->snaph == HEIGHT(c)
+			&& c->isfloating && !c->isfullscreen) {
+		return; /* nothing changed */
+	}
+	snap_index_remove(c);
+	if (!c->isfloating || c->isfullscreen) return;
+
+	c->snapmon = c->mon;
+	c->snapx = c->x;
+	c->snapy = c->y;
+	c->snapw = WIDTH(c);
+	c->snaph = HEIGHT(c);
+	edge_index_insert(&c->mon->xedges, c->snapx, c->snapy, c->snapy + c->snaph, c);
+	edge_index_insert(&c->mon->xedges, c->snapx + c->snapw, c->snapy, c->snapy + c->snaph, c);
+	edge_index_insert(&c->mon->yedges, c->snapy, c->snapx, c->snapx + c->snapw, c);
+	edge_index_insert(&c->mon->yedges, c->snapy + c->snaph, c->snapx, c->snapx + c->snapw, c);
+}
+
+/**
+ * Snaps a prospective client position to the edges of other visible floating clients on the selected monitor.
+ * On each axis, the closer of the two snaps wins, so an edge that is already aligned stays aligned.
+ * 
+ * @param	c	The client being moved.
+ * @param	x	The prospective x coordinate, adjusted in place.
+ * @param	y	The prospective y coordinate, adjusted in place.
+ */
+void
+snap_to_clients (Client *c, int *x, int *y) {
+	int left, right, top, bottom;
+
+	left = edge_index_nearest(&selmon->xedges, *x, *y, *y + HEIGHT(c), c);
+	right = edge_index_nearest(&selmon->xedges, *x + WIDTH(c), *y, *y + HEIGHT(c), c);
+	top = edge_index_nearest(&selmon->yedges, *y, *x, *x + WIDTH(c), c);
+	bottom = edge_index_nearest(&selmon->yedges, *y + HEIGHT(c), *x, *x + WIDTH(c), c);
+	if (abs(right) < abs(left)) {
+		left = right;
+	}
+	if (left != INT_MAX) {
+		*x += left;
+	}
+	if (abs(bottom) < abs(top)) {
+		top = bottom;
+	}
+	if (top != INT_MAX) {
+		*y += top;
+	}
+}
+
+/**
+ * Completes the spawn-to-map measurement if a client's window belongs to a process spawned by cmd_spawn
+ * (according to _NET_WM_PID, see get_client_pid) and is the first window it mapped. The latency is added to the statistics of
+ * its command, which take over the least used slot when the command is new.
+ * 
+ * @param	c	The new client.
+ */
+void
+spawn_match (Client *c) {
+	int i;
+	long latency;
+	Spawn *s = NULL;
+	SpawnStats *st = spawnstats;
+
+	for (i = 0; i < MAXSPAWNS && !spawns[i].pid; i++);
+	if (i == MAXSPAWNS) return; /* nothing to wait for, don't bother looking up the pid */
+	if (c->pid < 0) {
+		c->pid = get_client_pid(c);
+	}
+	if (!c->pid) return;
+	for (i = 0; i < MAXSPAWNS && !s; i++) {
+		if (spawns[i].pid == c->pid) {
+			s = &spawns[i];
+		}
+	}
+	if (!s) return;
+	latency = get_time_ms() - s->time;
+	s->pid = 0;
+	for (i = 0; i < MAXSPAWNSTATS && strcmp(spawnstats[i].cmd, s->cmd); i++) {
+		if (spawnstats[i].count < st->count) {
+			st = &spawnstats[i];
+		}
+	}
+	if (i < MAXSPAWNSTATS) {
+		st = &spawnstats[i];
+	} else {
+		memset(st, 0, sizeof *st);
+		memcpy(st->cmd, s->cmd, sizeof st->cmd);
+	}
+	st->count++;
+	st->last = latency;
+	st->max = MAX(st->max, latency);
+	st->total += latency;
+	schedule_stats_update();
+}
+
+/**
+ * Remembers when a process was spawned, so spawn_match can measure how long it takes to map its first window.
+ * Processes that never map one are eventually overwritten by newer ones.
+ * The command is named after the executable, or the script when it is run with "sh -c".
+ * 
+ * @param	pid		The spawned process.
+ * @param	argv	Its arguments.
+ */
+void
+spawn_record (pid_t pid, char **argv) {
+	const char *cmd = argv[0];
+	Spawn *s = &spawns[nextspawn++ % MAXSPAWNS];
+
+	if (argv[1] && !strcmp(argv[1], "-c") && argv[2]) {
+		cmd = argv[2];
+	} else if (strrchr(cmd, '/')) {
+		cmd = strrchr(cmd, '/') + 1;
+	}
+	s->pid = pid;
+	s->time = get_time_ms();
+	snprintf(s->cmd, sizeof s->cmd, "%s", cmd);
+}
+
 /**
  * Attaches a client to its monitor's stack of clients.  The stack determines draw order, whereas the list of clients doesn't.
  * 
@@ -2789,6 +5951,255 @@ stack_detach (Client *c) {
 	}
 }
 
+/**
+ * Lays out the clients of the occupied tags next to the selected tag (see cmd_cycle_view) while they're hidden.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+stage_adjacent_tags (void *unused) {
+	int next = next_occupied_tag(selmon, +1), prev = next_occupied_tag(selmon, -1);
+
+	if (next >= 0 && !TAGSET_HAS(selmon->tagset[selmon->selected_tags], next)) {
+		stage_tag(selmon, next);
+	}
+	if (prev >= 0 && prev != next && !TAGSET_HAS(selmon->tagset[selmon->selected_tags], prev)) {
+		stage_tag(selmon, prev);
+	}
+}
+
+/**
+ * Runs the layout of a hidden tag with the settings it would be viewed with, resizing its tiled clients to
+ * their final size but leaving them offscreen. The result goes to the tag's layout cache, so viewing the
+ * tag afterwards only moves the windows into place. Tags that share tiled clients with the current view
+ * are left alone, since their clients can't be resized without disturbing what's on screen.
+ * 
+ * @param	m	The target monitor.
+ * @param	tag	The index of the tag.
+ */
+void
+stage_tag (Monitor *m, int tag) {
+	Monitor saved = *m;
+	unsigned int savedtag = m->pertag->curtag;
+	TagState *st;
+	Client *c;
+
+	for (c = m->clients; c; c = c->next) {
+		if (TAGSET_HAS(c->tags, tag) && !c->isfloating && !c->minimized && TAGISVISIBLE(c)) return;
+	}
+	memset(&m->tagset[m->selected_tags], 0, sizeof m->tagset[m->selected_tags]);
+	TAGSET_ADD(m->tagset[m->selected_tags], tag);
+	m->pertag->curtag = tag + 1;
+	st = get_tag_state(m, m->pertag->curtag);
+	m->marked_width = st->marked_width;
+	m->selected_layout = st->selected_layout;
+	m->layout[m->selected_layout] = st->layoutidxs[m->selected_layout];
+	m->show_tagbar = st->show_tagbar;
+	if (m->layout[m->selected_layout]->arrange) {
+		for (m->num_marked_win = 0, c = m->clients; c; c = c->next) {
+			if (TAGISVISIBLE(c) && c->marked) {
+				m->num_marked_win++;
+			}
+		}
+		update_window_area(m);
+		staging = True;
+		if (!layout_cache_apply(m)) {
+			m->layout[m->selected_layout]->arrange(m);
+			layout_cache_store(m);
+		}
+		staging = False;
+	}
+	m->pertag->curtag = savedtag;
+	m->tagset[m->selected_tags] = saved.tagset[saved.selected_tags];
+	m->marked_width = saved.marked_width;
+	m->selected_layout = saved.selected_layout;
+	m->layout[0] = saved.layout[0];
+	m->layout[1] = saved.layout[1];
+	m->show_tagbar = saved.show_tagbar;
+	m->num_marked_win = saved.num_marked_win;
+	m->winarea_x = saved.winarea_x;
+	m->winarea_y = saved.winarea_y;
+	m->winarea_width = saved.winarea_width;
+	m->winarea_height = saved.winarea_height;
+	m->tagbar_pos = saved.tagbar_pos;
+	m->clientbar_pos = saved.clientbar_pos;
+	memcpy(m->layout_symbol, saved.layout_symbol, sizeof m->layout_symbol);
+}
+
+/**
+ * Jumps to the client chosen in the window switcher: selects its monitor, views its first tag if it isn't
+ * visible and unhides it if necessary.
+ * 
+ * @param	item	The chosen item, its data is the client.
+ * @param	query	Unused.
+ */
+void
+switcher_select (MenuItem *item, const char *query) {
+	Client *c;
+	Arg a;
+
+	if (!item) return;
+	c = (Client *)item->data;
+	if (c->scratchpad && tagset_empty(&c->tags)) { /* hidden scratchpads are summoned, not visited */
+		a.i = c->scratchpad - 1;
+		cmd_toggle_scratchpad(&a);
+		return;
+	}
+	if (c->mon != selmon) {
+		unfocus(selmon->sel);
+		selmon = c->mon;
+	}
+	if (!TAGISVISIBLE(c)) {
+		a.i = tagset_first(&c->tags);
+		cmd_view_tag(&a);
+	}
+	if (c->minimized) {
+		c->minimized = False;
+		arrange(selmon);
+	}
+	focus(c);
+	restack(selmon);
+}
+
+/**
+ * Restricts a tagset to the tags of another one.
+ * 
+ * @param	dst	The target tagset.
+ * @param	src	The tags to keep.
+ */
+void
+tagset_and (Tagset *dst, const Tagset *src) {
+	int i;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		dst->w[i] &= src->w[i];
+	}
+}
+
+/**
+ * Returns True if a tagset contains no tags.
+ * 
+ * @param	s	The target tagset.
+ */
+Bool
+tagset_empty (const Tagset *s) {
+	int i;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		if (s->w[i]) return False;
+	}
+	return True;
+}
+
+/**
+ * Returns True if two tagsets contain the same tags.
+ * 
+ * @param	a	The first tagset.
+ * @param	b	The second tagset.
+ */
+Bool
+tagset_equal (const Tagset *a, const Tagset *b) {
+	return !memcmp(a->w, b->w, sizeof a->w);
+}
+
+/**
+ * Returns the index of the lowest tag in a tagset, or -1 if it is empty.
+ * 
+ * @param	s	The target tagset.
+ */
+int
+tagset_first (const Tagset *s) {
+	int i, b;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		if (!s->w[i]) continue;
+		for (b = 0; !(s->w[i] & 1ULL << b); b++);
+		return i * TAGWORDBITS + b;
+	}
+	return -1;
+}
+
+/**
+ * Returns True if two tagsets have at least one tag in common. This is the visibility test (see TAGISVISIBLE),
+ * it compares whole words and stops at the first match.
+ * 
+ * @param	a	The first tagset.
+ * @param	b	The second tagset.
+ */
+Bool
+tagset_intersects (const Tagset *a, const Tagset *b) {
+	int i;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		if (a->w[i] & b->w[i]) return True;
+	}
+	return False;
+}
+
+/**
+ * Adds the tags of one tagset to another.
+ * 
+ * @param	dst	The target tagset.
+ * @param	src	The tags to add.
+ */
+void
+tagset_or (Tagset *dst, const Tagset *src) {
+	int i;
+
+	for (i = 0; i < TAGWORDS; i++) {
+		dst->w[i] |= src->w[i];
+	}
+}
+
+/**
+ * Arms (or re-arms) a timer.
+ * 
+ * @param	t	The target timer.
+ * @param	delay	The number of milliseconds until the timer is due.
+ */
+void
+timer_arm (Timer *t, int delay) {
+	Timer **tp;
+
+	timer_disarm(t);
+	t->due = get_time_ms() + delay;
+	for (tp = &timers; *tp && (*tp)->due <= t->due; tp = &(*tp)->next);
+	t->next = *tp;
+	*tp = t;
+	t->armed = True;
+}
+
+/**
+ * Disarms a timer, if it is armed.
+ * 
+ * @param	t	The target timer.
+ */
+void
+timer_disarm (Timer *t) {
+	Timer **tp;
+
+	if (!t->armed) return;
+	for (tp = &timers; *tp && *tp != t; tp = &(*tp)->next);
+	if (*tp) {
+		*tp = t->next;
+	}
+	t->armed = False;
+}
+
+/**
+ * Returns the number of milliseconds until the first timer is due, or -1 if no timer is armed.
+ */
+int
+timer_next_delay (void) {
+	long long delay;
+
+	if (!timers) {
+		return -1;
+	}
+	delay = timers->due - get_time_ms();
+	return delay < 0 ? 0 : (int)delay;
+}
+
 /**
  * Removes focus from a given client.
  * 
@@ -2814,8 +6225,22 @@ unmanage(Client *c, Bool destroyed) {
 	XWindowChanges wc;
 
 	/* The server grab construct avoids race conditions. */
+	clear_tag_selection(c);
 	detach(c);
 	stack_detach(c);
+	snap_index_remove(c);
+	timer_disarm(&c->titletimer);
+	menu_remove(c);
+	if (preview.c == c) {
+		preview_close();
+	}
+	if (c->thumb) {
+		XFreePixmap(dpy, c->thumb);
+	}
+	icon_release(c->icon);
+	if (c->scratchpad) { /* spawn it again next time */
+		scratchtime[c->scratchpad - 1] = 0;
+	}
 	if (!destroyed) {
 		wc.border_width = c->oldbw;
 		XGrabServer(dpy);
@@ -2840,43 +6265,7 @@ unmanage(Client *c, Bool destroyed) {
  */
 void
 update_bar_positions (Monitor *m) {
-	Client *c;
-	int nvis = 0, nhid = 0;
-
-	m->winarea_y = m->mon_y;
-	m->winarea_height = m->mon_height;
-	if (m->show_tagbar) {
-		m->winarea_height -= bh;
-		m->tagbar_pos = m->tags_on_top ? m->winarea_y : m->winarea_y + m->winarea_height;
-		if (m->tags_on_top) {
-			m->winarea_y += bh;
-		}
-	} else {
-		m->tagbar_pos = -bh;
-	}
-
-	for (c = m->clients; c; c = c->next) {
-		if (TAGISVISIBLE(c)) {
-			nvis++;
-			if (c->minimized) {
-				nhid++;
-			}
-		}
-	}
-	
-	if (m->show_clientbar == show_clientbar_always
-			|| ((m->show_clientbar == show_clientbar_auto) && (nhid > 0
-			|| ((nvis > 1) && (m->layout[m->selected_layout]->arrange == arrange_monocle))
-			|| ((nvis > 1 + m->num_marked_win) && m->layout[m->selected_layout]->arrange == arrange_deck)))) {
-		m->winarea_height -= th;
-		m->clientbar_pos = m->tags_on_top ? m->winarea_y + m->winarea_height : m->winarea_y;
-		if (!m->tags_on_top) {
-			m->winarea_y += th;
-		}
-	} else {
-		m->clientbar_pos = -th;
-	}
-	
+	update_window_area(m);
 	XMoveResizeWindow(dpy, m->clientbar_win, m->winarea_x, m->clientbar_pos, m->winarea_width, th);
 }
 
@@ -2906,10 +6295,14 @@ Bool
 update_geometry (void) {
 	Bool dirty = False;
 
+#ifdef XRANDR
+	if (randr_active) {
+		dirty = update_geometry_randr();
+	} else
+#endif /* XRANDR */
 #ifdef XINERAMA
 	if (XineramaIsActive(dpy)) {
 		int i, j, n, nn;
-		Client *c;
 		Monitor *m;
 		XineramaScreenInfo *info = XineramaQueryScreens(dpy, &nn);
 		XineramaScreenInfo *unique = NULL;
@@ -2940,7 +6333,7 @@ update_geometry (void) {
 						|| (unique[i].x_org != m->mon_x || unique[i].y_org != m->mon_y
 						|| unique[i].width != m->mon_width || unique[i].height != m->mon_height)) {
 							
-					dirty = True;
+					dirty = m->dirty = True;
 					m->num = i;
 					m->mon_x = m->winarea_x = unique[i].x_org;
 					m->mon_y = m->winarea_y = unique[i].y_org;
@@ -2952,15 +6345,8 @@ update_geometry (void) {
 		} else { /* fewer monitors available nn < n */
 			for (i = nn; i < n; i++) {
 				for (m = mons; m && m->next; m = m->next);
-				while (m->clients) {
-					dirty = True;
-					c = m->clients;
-					m->clients = c->next;
-					stack_detach(c);
-					c->mon = mons;
-					attach(c);
-					stack_attach(c);
-				}
+				dirty = True;
+				evacuate_monitor(m, mons);
 				if (m == selmon) {
 					selmon = mons;
 				}
@@ -2976,19 +6362,153 @@ update_geometry (void) {
 			mons = monitor_create();
 		}
 		if (mons->mon_width != sw || mons->mon_height != sh) {
-			dirty = True;
+			dirty = mons->dirty = True;
 			mons->mon_width = mons->winarea_width = sw;
 			mons->mon_height = mons->winarea_height = sh;
 			update_bar_positions(mons);
 		}
 	}
 	if (dirty) {
+		monitor_index_update();
 		selmon = mons;
 		selmon = window_to_monitor(root);
 	}
 	return dirty;
 }
 
+#ifdef XRANDR
+/**
+ * Updates the monitors from the RandR monitor list.
+ * Monitors are matched by name, so only monitors that actually changed are marked dirty. Monitors that disappear
+ * hand their clients (tags included) to the first monitor and are kept aside with their per-tag settings; when they
+ * come back, they pick up their settings and clients again.
+ */
+Bool
+update_geometry_randr (void) {
+	int i, n;
+	Bool dirty = False;
+	Client *c, *next;
+	Monitor *m, **mp, *old, **tail;
+	XRRMonitorInfo *info;
+
+	if (!(info = XRRGetMonitors(dpy, root, True, &n)) || n <= 0) { /* keep what we have */
+		if (info) {
+			XRRFreeMonitors(info);
+		}
+		return False;
+	}
+	old = mons;
+	mons = NULL;
+	tail = &mons;
+	for (i = 0; i < n; i++) {
+		for (mp = &old; *mp && (*mp)->name != info[i].name; mp = &(*mp)->next);
+		if (!*mp) {
+			for (mp = &dormant; *mp && (*mp)->name != info[i].name; mp = &(*mp)->next);
+		}
+		if ((m = *mp)) {
+			*mp = m->next;
+		} else {
+			m = monitor_create();
+			m->name = info[i].name;
+		}
+		m->next = NULL;
+		*tail = m;
+		tail = &m->next;
+		if (m->num != i) {
+			m->num = i;
+			dirty = True;
+		}
+		if (!m->tagbar_win || info[i].x != m->mon_x || info[i].y != m->mon_y
+				|| info[i].width != m->mon_width || info[i].height != m->mon_height) {
+			dirty = m->dirty = True;
+			m->mon_x = m->winarea_x = info[i].x;
+			m->mon_y = m->winarea_y = info[i].y;
+			m->mon_width = m->winarea_width = info[i].width;
+			m->mon_height = m->winarea_height = info[i].height;
+			update_bar_positions(m);
+		}
+	}
+	XRRFreeMonitors(info);
+
+	/* monitors that went away */
+	while ((m = old)) {
+		old = m->next;
+		dirty = True;
+		evacuate_monitor(m, mons);
+		if (m == selmon) {
+			selmon = mons;
+		}
+		XDestroyWindow(dpy, m->tagbar_win);
+		XDestroyWindow(dpy, m->clientbar_win);
+		XDestroyWindow(dpy, m->crossing_win);
+		m->tagbar_win = m->clientbar_win = m->crossing_win = None;
+		m->next = dormant;
+		dormant = m;
+	}
+
+	/* clients of monitors that came back */
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = next) {
+			next = c->next;
+			if (!c->homemon || c->homemon == m->name) continue;
+			for (mp = &mons; *mp && (*mp)->name != c->homemon; mp = &(*mp)->next);
+			if (!*mp) continue;
+			clear_tag_selection(c);
+			detach(c);
+			stack_detach(c);
+			c->mon = *mp;
+			c->homemon = None;
+			attach(c);
+			stack_attach(c);
+			snap_index_update(c);
+			m->dirty = (*mp)->dirty = dirty = True;
+		}
+	}
+	return dirty;
+}
+#endif /* XRANDR */
+
+/**
+ * Reads a client's _NET_WM_ICON, picks the image closest to the icon size (the smallest one that isn't smaller,
+ * or else the largest one) and replaces the client's icon with it. Only called when the property changes or the
+ * client is first drawn in a bar; drawing the bars just copies the cached icon.
+ * 
+ * @param	c	The target client.
+ */
+void
+update_icon (Client *c) {
+	int di;
+	unsigned long i, n, dl, w, h, size, bestw = 0, besth = 0, bestsize = 0, best = 0;
+	unsigned char *p = NULL;
+	unsigned long *data;
+	Atom da;
+	Icon *old = c->icon;
+
+	c->icon = NULL;
+	c->iconloaded = True;
+	if (show_icons && XGetWindowProperty(dpy, c->win, netatom[NetWMIcon], 0L, LONG_MAX, False, XA_CARDINAL,
+										 &da, &di, &n, &dl, &p) == Success && p) {
+		data = (unsigned long *)p; /* format 32 properties are returned as longs */
+		for (i = 0; i + 2 <= n; i += 2 + w * h) {
+			w = data[i] & 0xffffffff;
+			h = data[i + 1] & 0xffffffff;
+			if (!w || !h || w > 4096 || h > 4096 || w * h > n - i - 2) break;
+			size = MAX(w, h);
+			if (!bestsize || (bestsize < iconsize && size > bestsize) || (size >= iconsize && size < bestsize)) {
+				bestw = w;
+				besth = h;
+				bestsize = size;
+				best = i + 2;
+			}
+		}
+		if (bestsize) {
+			c->icon = icon_create(data + best, bestw, besth);
+		}
+		XFree(p);
+	}
+	icon_release(old);
+}
+
 /**
  * Updates the numlock mask.
  */
@@ -3056,6 +6576,174 @@ update_onscreen (Monitor *m) {
 	}
 }
 
+/**
+ * Deprioritizes the processes whose windows have all been on hidden tags or minimized for deprioritize_delay
+ * milliseconds (for clients the policy applies to, see apply_rules), and restores them as soon as one of their
+ * windows shows. The delay keeps quick tag toggles from renicing anything.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+update_priorities (void *unused) {
+	int i;
+	long long now = get_time_ms(), delay = -1;
+	Bool found, visible;
+	ProcPriority *p;
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next) { /* start tracking new processes */
+		for (c = m->clients; c; c = c->next) {
+			if (!c->deprioritize || c->pid <= 0) continue;
+			for (i = 0; i < nprocprios && procprios[i].pid != c->pid; i++);
+			if (i == nprocprios && nprocprios < MAXPROCPRIOS) {
+				memset(&procprios[i], 0, sizeof(ProcPriority));
+				procprios[nprocprios++].pid = c->pid;
+			}
+		}
+	}
+	for (i = 0; i < nprocprios; i++) {
+		p = &procprios[i];
+		found = visible = False;
+		for (m = mons; m; m = m->next) {
+			for (c = m->clients; c; c = c->next) {
+				if (c->pid < 0) { /* any window of the process keeps it from being deprioritized */
+					c->pid = get_client_pid(c);
+				}
+				if (c->pid == p->pid) {
+					found = True;
+					visible |= TAGISVISIBLE(c) && !c->minimized;
+				}
+			}
+		}
+		if (!found || visible) {
+			p->hiddensince = 0;
+			priority_restore(p);
+			if (!found) { /* no windows left */
+				procprios[i--] = procprios[--nprocprios];
+			}
+		} else if (!p->lowered) {
+			if (!p->hiddensince) {
+				p->hiddensince = now;
+			}
+			if (now - p->hiddensince >= deprioritize_delay) {
+				priority_lower(p);
+			} else if (delay < 0 || deprioritize_delay - (now - p->hiddensince) < delay) {
+				delay = deprioritize_delay - (now - p->hiddensince);
+			}
+		}
+	}
+	if (delay >= 0) {
+		timer_arm(&priotimer, delay);
+	}
+}
+
+/**
+ * Samples the resident memory of the clients' processes and, with XRes, the pixmap memory and resource count
+ * of their X connections, so heavy clients can be found in _WASDWM_STATS (see update_stats) or the client bar.
+ * Windows of the same connection report the same X server resources. Runs every resource_sample_interval ms.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+update_resources (void *unused) {
+	Client *c;
+	Monitor *m;
+#ifdef XRES
+	int j, lo, hi, mid, nxclients = 0, ntypes;
+	XResClient *xclients = NULL;
+	XResType *types;
+	ResourceSample *samples = NULL, *rs;
+
+	if (xres_active && XResQueryClients(dpy, &nxclients, &xclients) && nxclients > 0) {
+		qsort(xclients, nxclients, sizeof(XResClient), _cmpxresclient);
+		if (!(samples = calloc(nxclients, sizeof(ResourceSample)))) {
+			die("fatal: could not malloc() %u bytes\n", nxclients * sizeof(ResourceSample));
+		}
+	} else {
+		nxclients = 0;
+	}
+#endif /* XRES */
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = c->next) {
+			if (c->pid < 0) {
+				c->pid = get_client_pid(c);
+			}
+			c->rss = c->pid ? get_process_rss(c->pid) : 0;
+#ifdef XRES
+			c->pixmapbytes = c->xresources = 0;
+			/* the window belongs to the connection with the last resource base not above it, if to any */
+			for (lo = 0, hi = nxclients; lo < hi;) {
+				mid = (lo + hi) / 2;
+				if (xclients[mid].resource_base <= c->win) {
+					lo = mid + 1;
+				} else {
+					hi = mid;
+				}
+			}
+			if (!lo || (c->win & ~xclients[lo - 1].resource_mask) != xclients[lo - 1].resource_base) continue;
+			rs = &samples[lo - 1];
+			if (!rs->sampled) { /* query each connection once, however many windows it has */
+				rs->sampled = True;
+				if (!XResQueryClientPixmapBytes(dpy, xclients[lo - 1].resource_base, &rs->pixmapbytes)) {
+					rs->pixmapbytes = 0;
+				}
+				if (XResQueryClientResources(dpy, xclients[lo - 1].resource_base, &ntypes, &types)) {
+					for (j = 0; j < ntypes; j++) {
+						rs->xresources += types[j].count;
+					}
+					XFree(types);
+				}
+			}
+			c->pixmapbytes = rs->pixmapbytes;
+			c->xresources = rs->xresources;
+#endif /* XRES */
+		}
+	}
+#ifdef XRES
+	if (xclients) {
+		XFree(xclients);
+	}
+	free(samples);
+#endif /* XRES */
+	schedule_stats_update();
+	if (show_client_resources) {
+		draw_bars();
+	}
+	if (resource_sample_interval) {
+		timer_arm(&resourcetimer, resource_sample_interval);
+	}
+}
+
+/**
+ * Applies changes of the screen configuration once a burst of configuration events has been handled.
+ * Only monitors whose geometry changed are arranged again.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+update_screens (void *unused) {
+	Monitor *m;
+
+	if (!update_geometry() && drw->w == sw) return;
+
+	gfx_resize(drw, sw, (menu_lines + 1) * bh); /* tall enough for the bars and the menu */
+	init_bars();
+	for (m = mons; m; m = m->next) {
+		if (!m->dirty) continue;
+		/* the client bar is handled by arrange() */
+		XMoveResizeWindow(dpy, m->tagbar_win, m->winarea_x, m->tagbar_pos, m->winarea_width, bh);
+		XMoveResizeWindow(dpy, m->crossing_win, m->mon_x, m->mon_y, m->mon_width, m->mon_height);
+		if (m != selmon) {
+			arrange(m);
+		}
+	}
+	focus(NULL); /* arranges selmon */
+	for (m = mons; m; m = m->next) {
+		m->dirty = False;
+	}
+}
+
 /**
  * Updates size hints for a given client window.
  * 
@@ -3070,6 +6758,8 @@ update_size_hints (Client *c) {
 		/* size is uninitialized, ensure that size.flags aren't used */
 		size.flags = PSize;
 	}
+	c->hintflags = size.flags;
+	c->mon->version++;
 	if (size.flags & PBaseSize) {
 		c->basew = size.base_width;
 		c->baseh = size.base_height;
@@ -3124,6 +6814,62 @@ update_statusarea (void) {
 	}
 }
 
+/**
+ * Rewrites the _WASDWM_STATS property (see "xprop -id <_NET_SUPPORTING_WM_CHECK> _WASDWM_STATS").
+ * The first line holds the number of times per second the WM woke up to read from the X connection.
+ * Each following line describes a client: its window, ConfigureRequests received/applied, requests per second,
+ * its process, resident memory, X server pixmap memory and resource count (see update_resources) and title.
+ * The remaining lines hold the spawn-to-map latency of the commands run by cmd_spawn: how often their first window was
+ * seen, and the last, average and highest latency.
+ * 
+ * @param	unused	Unused (timer callback).
+ */
+void
+update_stats (void *unused) {
+	char *buf;
+	unsigned int rate;
+	size_t len, size = 64 + MAXSPAWNSTATS * (96 + SPAWNCMDLEN);
+	int i;
+	Bool active;
+	Client *c;
+	Monitor *m;
+
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = c->next) {
+			size += 256 + strlen(c->name);
+		}
+	}
+	if (!(buf = malloc(size))) {
+		die("fatal: could not malloc() %u bytes\n", size);
+	}
+	rate = rate_get(&wakeups);
+	active = rate > 0;
+	len = snprintf(buf, size, "wakeups=%u/s\n", rate);
+	for (m = mons; m; m = m->next) {
+		for (c = m->clients; c; c = c->next) {
+			rate = rate_get(&c->cfgrate);
+			active |= rate > 0;
+			len += snprintf(buf + len, size - len,
+							"0x%lx cfgreq=%lu applied=%lu rate=%u/s pid=%ld rss=%luK pixmaps=%luK xres=%u %s\n",
+							c->win, c->cfgreqs, c->cfgapplied, rate, (long)MAX(c->pid, 0), c->rss, c->pixmapbytes / 1024,
+							c->xresources, c->name);
+		}
+	}
+	for (i = 0; i < MAXSPAWNSTATS; i++) {
+		if (spawnstats[i].count) {
+			len += snprintf(buf + len, size - len, "spawn count=%u last=%lldms avg=%lldms max=%lldms %s\n",
+							spawnstats[i].count, spawnstats[i].last, spawnstats[i].total / spawnstats[i].count,
+							spawnstats[i].max, spawnstats[i].cmd);
+		}
+	}
+	XChangeProperty(dpy, wmcheckwin, wasdwmatom[WasdwmStats], utf8string, 8,
+			PropModeReplace, (unsigned char *)buf, len);
+	free(buf);
+	if (active) { /* make sure the rates are seen to decay */
+		schedule_stats_update();
+	}
+}
+
 /**
  * Updates a client's title.
  * 
@@ -3148,7 +6894,13 @@ void
 update_visibility (Client *c) {
 	if (!c) return;
 	if (TAGISVISIBLE(c) && (c->onscreen || (!hide_buried_windows && !c->minimized))) { /* show clients top down */
-		XMoveWindow(dpy, c->win, c->x, c->y);
+		if (!c->shown) {
+			XMoveWindow(dpy, c->win, c->x, c->y);
+			c->shown = True;
+			if (c == preview.c) { /* no need for a preview, nor for the offscreen pixmap behind it */
+				preview_close();
+			}
+		}
 		if ((!c->mon->layout[c->mon->selected_layout]->arrange || c->isfloating) && !c->isfullscreen) {
 			resize(c, c->x, c->y, c->w, c->h, False);
 		}
@@ -3156,11 +6908,59 @@ update_visibility (Client *c) {
 		update_visibility(c->snext);
 	} else { /* hide clients bottom up */
 		update_visibility(c->snext);
-		XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+		if (c->shown) {
+			XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+			c->shown = False;
+		}
 		set_client_state(c, IconicState);
 	}
 }
 
+/**
+ * Computes the positions of the bars and the window area of a monitor from its settings (without moving any windows).
+ * 
+ * @param	m	The target monitor.
+ */
+void
+update_window_area (Monitor *m) {
+	Client *c;
+	int nvis = 0, nhid = 0;
+
+	m->winarea_y = m->mon_y;
+	m->winarea_height = m->mon_height;
+	if (m->show_tagbar) {
+		m->winarea_height -= bh;
+		m->tagbar_pos = m->tags_on_top ? m->winarea_y : m->winarea_y + m->winarea_height;
+		if (m->tags_on_top) {
+			m->winarea_y += bh;
+		}
+	} else {
+		m->tagbar_pos = -bh;
+	}
+
+	for (c = m->clients; c; c = c->next) {
+		if (TAGISVISIBLE(c)) {
+			nvis++;
+			if (c->minimized) {
+				nhid++;
+			}
+		}
+	}
+	
+	if (m->show_clientbar == show_clientbar_always
+			|| ((m->show_clientbar == show_clientbar_auto) && (nhid > 0
+			|| ((nvis > 1) && (m->layout[m->selected_layout]->arrange == arrange_monocle))
+			|| ((nvis > 1 + m->num_marked_win) && m->layout[m->selected_layout]->arrange == arrange_deck)))) {
+		m->winarea_height -= th;
+		m->clientbar_pos = m->tags_on_top ? m->winarea_y + m->winarea_height : m->winarea_y;
+		if (!m->tags_on_top) {
+			m->winarea_y += th;
+		}
+	} else {
+		m->clientbar_pos = -th;
+	}
+}
+
 /**
  * Updates the window type of a client based on the properties of its window.
  * 
@@ -3204,6 +7004,49 @@ update_wm_hints (Client *c) {
 	}
 }
 
+/**
+ * Views a tagset on the selected monitor.
+ * 
+ * @param	ts	The tagset to view, restricted to the existing tags. NULL (or a tagset without existing tags)
+ * 				switches back to the previously viewed tagset if view_tag_toggles is set.
+ */
+void
+view_tagset (const Tagset *ts) {
+	Tagset newtagset = {{0}};
+	unsigned int tmptag;
+	TagState *st;
+
+	if (ts) {
+		newtagset = *ts;
+		tagset_and(&newtagset, &tagmask);
+	}
+	if (!tagset_empty(&newtagset) && !tagset_equal(&newtagset, &selmon->tagset[selmon->selected_tags])) {
+		selmon->selected_tags ^= 1; /* toggle sel tagset */
+		selmon->pertag->prevtag = selmon->pertag->curtag;
+		selmon->tagset[selmon->selected_tags] = newtagset;
+		if (tagset_equal(&newtagset, &tagmask)) {
+			selmon->pertag->curtag = 0;
+		} else {
+			selmon->pertag->curtag = tagset_first(&newtagset) + 1;
+		}
+	} else if (view_tag_toggles) {
+		selmon->selected_tags ^= 1; /* toggle sel tagset */
+		tmptag = selmon->pertag->prevtag;
+		selmon->pertag->prevtag = selmon->pertag->curtag;
+		selmon->pertag->curtag = tmptag;
+	}
+	st = get_tag_state(selmon, selmon->pertag->curtag);
+	selmon->marked_width = st->marked_width;
+	selmon->selected_layout = st->selected_layout;
+	selmon->layout[selmon->selected_layout] = st->layoutidxs[selmon->selected_layout];
+	selmon->layout[selmon->selected_layout^1] = st->layoutidxs[selmon->selected_layout^1];
+	if (selmon->show_tagbar != st->show_tagbar) {
+		cmd_toggle_tagbar(NULL);
+	}
+	focus(get_tag_selection(selmon));
+	arrange(selmon);
+}
+
 /**
  * Returns the Client structure associated with a given window.
  * 
@@ -3239,7 +7082,7 @@ window_to_monitor (Window w) {
 		return rect_to_monitor(x, y, 1, 1);
 	}
 	for (m = mons; m; m = m->next) {
-		if (w == m->tagbar_win || w == m->clientbar_win) {
+		if (w == m->tagbar_win || w == m->clientbar_win || w == m->crossing_win) {
 			return m;
 		}
 	}
@@ -3249,6 +7092,14 @@ window_to_monitor (Window w) {
 	return selmon;
 }
 
+/**
+ * Comparison function for sorting and searching arrays of windows.
+ */
+int
+_cmpwin (const void *p1, const void *p2) {
+	return (*(Window *)p1 > *(Window *)p2) - (*(Window *)p1 < *(Window *)p2);
+}
+
 /**
  * Key function for the qsort in draw_clientbar.
  */
@@ -3257,7 +7108,113 @@ _cmpint (const void *p1, const void *p2) {
   /* The actual arguments to this function are "pointers to
 	 pointers to char", but strcmp(3) arguments are "pointers
 	 to char", hence the following cast plus dereference */
-  return *((int*) p1) > * (int*) p2;
+  return (*(int*) p1 > *(int*) p2) - (*(int*) p1 < *(int*) p2);
+}
+
+/**
+ * Key function for the qsort in path_index_update.
+ */
+int
+_cmpstr (const void *p1, const void *p2) {
+	return strcmp(*(char * const *) p1, *(char * const *) p2);
+}
+
+/**
+ * Key function for the qsort in place_client.
+ */
+int
+_cmpsweep (const void *p1, const void *p2) {
+	const SweepEvent *a = p1, *b = p2;
+
+	return (a->pos > b->pos) - (a->pos < b->pos);
+}
+
+#ifdef XRES
+/**
+ * Key function for the qsort in update_resources.
+ */
+int
+_cmpxresclient (const void *p1, const void *p2) {
+	const XResClient *a = p1, *b = p2;
+
+	return (a->resource_base > b->resource_base) - (a->resource_base < b->resource_base);
+}
+#endif /* XRES */
+
+/**
+ * XCheckIfEvent predicate matching queued ConfigureRequests for the window in an EventScan.
+ * Stops matching once the window is mapped, unmapped or destroyed, so requests are never merged across those.
+ */
+Bool
+_pending_configure_request (Display *dpy, XEvent *ev, XPointer arg) {
+	EventScan *scan = (EventScan *)arg;
+
+	if (scan->blocked) {
+		return False;
+	}
+	switch (ev->type) {
+	case ConfigureRequest:
+		return ev->xconfigurerequest.window == scan->win;
+	case MapRequest:
+		scan->blocked = ev->xmaprequest.window == scan->win;
+		break;
+	case UnmapNotify:
+		scan->blocked = ev->xunmap.window == scan->win;
+		break;
+	case DestroyNotify:
+		scan->blocked = ev->xdestroywindow.window == scan->win;
+		break;
+	}
+	return False;
+}
+
+/**
+ * XCheckIfEvent predicate matching the input events dispatch_priority_events handles first.
+ */
+Bool
+_priority_event (Display *dpy, XEvent *ev, XPointer arg) {
+	int i;
+	Window w;
+	PriorityScan *scan = (PriorityScan *)arg;
+
+	switch (ev->type) {
+	case KeyPress:
+		return True;
+	case ButtonRelease:
+		scan->released = True;
+		return False;
+	case ButtonPress:
+	case EnterNotify:
+		w = ev->type == ButtonPress ? ev->xbutton.window : ev->xcrossing.window;
+		if (ev->type == ButtonPress && scan->released) {
+			return False; /* the release belongs to an earlier press, and would end a drag started by this one */
+		}
+		if (scan->nbusy > MAXBUSY) {
+			return False; /* too many to track, stay on the safe side */
+		}
+		for (i = 0; i < scan->nbusy; i++) {
+			if (scan->busy[i] == w) {
+				return False;
+			}
+		}
+		return True;
+	case MapRequest:
+		w = ev->xmaprequest.window;
+		break;
+	case UnmapNotify:
+		w = ev->xunmap.window;
+		break;
+	case DestroyNotify:
+		w = ev->xdestroywindow.window;
+		break;
+	default:
+		return False;
+	}
+	if (scan->nbusy < MAXBUSY) {
+		scan->busy[scan->nbusy] = w;
+	}
+	scan->nbusy++;
+	return False;
 }
 
 /**
@@ -3307,19 +7264,28 @@ _xerrorstart (Display *dpy, XErrorEvent *ee) {
  */
 int
 main (int argc, char *argv[]) {
+	unsigned int n;
+	struct pollfd pfd[2];
 	XEvent ev;
 	
 	if (argc == 2 && !strcmp("-v", argv[1])) {
 		die("wasdwm-"VERSION", see LICENSE for copyright and license details\n");
+	} else if (argc == 2 && !strcmp("-t", argv[1])) {
+		show_timings = True;
+	} else if (argc == 2 && !strcmp("-b", argv[1])) {
+		benchmark_placement();
+		return EXIT_SUCCESS;
 	} else if (argc != 1) {
-		die("usage: wasdwm [-v]\n");
+		die("usage: wasdwm [-v] [-t] [-b]\n");
 	}
+	log_startup_phase(NULL);
 	if (!setlocale(LC_CTYPE, "") || !XSupportsLocale()) {
 		fputs("warning: no locale support\n", stderr);
 	}
 	if (!(dpy = XOpenDisplay(NULL))) {
 		die("wasdwm: cannot open display\n");
 	}
+	log_startup_phase("connect");
 	/* Check for another WM */
 	xerrorxlib = XSetErrorHandler(_xerrorstart);
 	/* this causes an error if some other window manager is running */
@@ -3329,17 +7295,60 @@ main (int argc, char *argv[]) {
 	XSync(dpy, False);
 	
 	setup();
+	log_startup_phase("setup");
 	scan();
+	log_startup_phase("scan");
+	scratchpad_prespawn();
 	
 	/* main event loop */
 	XSync(dpy, False);
-	while (running && !XNextEvent(dpy, &ev)) {
-		if (handler[ev.type]) {
-			handler[ev.type](&ev); /* call handler */
+	pfd[0].fd = ConnectionNumber(dpy);
+	pfd[0].events = POLLIN;
+	pfd[1].fd = inotifyfd; /* ignored by poll if negative */
+	pfd[1].events = POLLIN;
+	while (running) {
+		for (n = 0; running && XPending(dpy); n++) {
+			if (n % PRIORITY_INTERVAL == 0) {
+				dispatch_priority_events();
+				if (!running || !XPending(dpy)) break;
+			}
+			XNextEvent(dpy, &ev);
+			if (ev.type < LASTEvent && handler[ev.type]) {
+				handler[ev.type](&ev); /* call handler */
+			}
+#ifdef XRANDR
+			else if (randr_active && (ev.type == randr_event_base + RRScreenChangeNotify
+					|| ev.type == randr_event_base + RRNotify)) {
+				event_randr_notify(&ev);
+			}
+#endif /* XRANDR */
+		}
+		run_timers();
+		if (running && !XPending(dpy)) {
+			if (poll(pfd, 2, timer_next_delay()) < 0 && errno != EINTR) {
+				die("wasdwm: poll failed\n");
+			}
+			if (pfd[1].revents & POLLIN) {
+				path_index_read();
+			}
+			if (pfd[0].revents & POLLIN) {
+				rate_add(&wakeups, 1);
+				schedule_stats_update();
+				if (stage_idle_time) { /* not idle yet */
+					timer_arm(&stagetimer, stage_idle_time);
+				}
+			}
 		}
 	}
 
+	if (restarting) {
+		save_state();
+	}
 	cleanup();
 	XCloseDisplay(dpy);
+	if (restarting) {
+		execvp(argv[0], argv);
+		die("wasdwm: cannot restart, execvp '%s' failed\n", argv[0]);
+	}
 	return EXIT_SUCCESS;
 }
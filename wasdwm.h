@@ -1,15 +1,28 @@
 /* See LICENSE file for copyright and license details. */
 
+#include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <locale.h>
+#include <poll.h>
 #include <stdarg.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif /* __linux__ */
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
@@ -19,6 +32,16 @@
 #ifdef XINERAMA
 #include <X11/extensions/Xinerama.h>
 #endif /* XINERAMA */
+#ifdef XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif /* XRANDR */
+#ifdef XRES
+#include <X11/extensions/XRes.h>
+#endif /* XRES */
+#ifdef XCOMPOSITE
+#include <X11/extensions/Xcomposite.h>
+#include <X11/extensions/Xrender.h>
+#endif /* XCOMPOSITE */
 
 /* macros */
 #define MAX(A, B)               ((A) > (B) ? (A) : (B))
@@ -27,26 +50,46 @@
 #define CLEANMASK(mask)         (mask & ~(numlockmask|LockMask) & (ShiftMask|ControlMask|Mod1Mask|Mod2Mask|Mod3Mask|Mod4Mask|Mod5Mask))
 #define INTERSECT(x,y,w,h,m)    (MAX(0, MIN((x)+(w),(m)->winarea_x+(m)->winarea_width) - MAX((x),(m)->winarea_x)) \
 							   * MAX(0, MIN((y)+(h),(m)->winarea_y+(m)->winarea_height) - MAX((y),(m)->winarea_y)))
-#define TAGISVISIBLE(C)         ((C->tags & C->mon->tagset[C->mon->selected_tags]))
+#define TAGISVISIBLE(C)         (tagset_intersects(&(C)->tags, &(C)->mon->tagset[(C)->mon->selected_tags]))
 #define LENGTH(X)               (sizeof X / sizeof X[0])
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
-#define TAGMASK                 ((1 << LENGTH(tags)) - 1)
+#define TAGWORDBITS             64
+#define TAGBIT(T)               (1ULL << ((T) % TAGWORDBITS))
+#define TAGSET_HAS(S, T)        ((S).w[(T) / TAGWORDBITS] & TAGBIT(T))
+#define TAGSET_ADD(S, T)        ((S).w[(T) / TAGWORDBITS] |= TAGBIT(T))
+#define TAGSET_DEL(S, T)        ((S).w[(T) / TAGWORDBITS] &= ~TAGBIT(T))
 #define TEXTW(X)                (font_get_text_width(drw->font, X, strlen(X)) + drw->font->h)
+#define ICONW(C)                (get_client_icon(C) ? (C)->icon->size + bh / 2 : 0) /* space taken by a client's icon next to its name */
 
 /* enums */
 enum { CursorNormal, CursorResize, CursorMove, CursorLast }; /* cursor */
 enum { SchemeNorm, SchemeSel, SchemeVisible, SchemeMinimized, SchemeUrgent, SchemeLast }; /* color schemes */
 enum { NetSupported, NetWMName, NetWMState,
 	   NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-	   NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+	   NetWMWindowTypeDialog, NetClientList, NetWMCheck, NetWMPid, NetWMIcon, NetLast }; /* EWMH atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
+enum { WasdwmStats, WasdwmState, WasdwmCommand, WasdwmLast }; /* wasdwm atoms */
+enum { DirLeft, DirRight, DirUp, DirDown, DirLast }; /* directions */
+enum { DeferArrange = 1, DeferRestack = 2, DeferDraw = 4 }; /* work postponed by run_actions */
+enum { ArgNone, ArgInt, ArgFloat, ArgLayout, ArgString, ArgTag }; /* argument types of IPC commands */
 enum { ClickTagBar, ClickClientBar, ClickLayoutSymbol, ClickStatusText, ClickWinTitle,
 	   ClickClientWin, ClickRootWin, ClickLast }; /* clicks */
 
 /* types & structures */
 
+#define MAXTAGS 128	/* number of tag slots, see cmd_create_tag */
+#define TAGWORDS ((MAXTAGS + TAGWORDBITS - 1) / TAGWORDBITS)
+#define TAGNAMELEN 32
+#define ALLTAGS -1	/* arg->i of the tag commands: all existing tags */
+#define PREVTAGS -2	/* arg->i of cmd_view_tag: the previously viewed tagset */
+#define CLICKEDTAG -3	/* arg->i of tag and client bar buttons: the clicked tag or client tab */
+
+typedef struct {
+	unsigned long long w[TAGWORDS];
+} Tagset;
+
 typedef union {
 	int i;
 	unsigned int ui;
@@ -62,23 +105,106 @@ typedef struct {
 	const Arg arg;
 } Button;
 
+typedef struct {
+	unsigned int count;	/* events during the current second */
+	unsigned int last;	/* events during the previous second */
+	long long start;	/* start of the current second, see get_time_ms() */
+} Rate;
+
+typedef struct {
+	unsigned long pixmapbytes;
+	unsigned int xresources;
+	Bool sampled;	/* the X connection was queried during this sample */
+} ResourceSample;
+
+typedef struct Timer Timer;
+struct Timer {
+	long long due;	/* see get_time_ms() */
+	void (*func)(void *arg);
+	void *arg;
+	Bool armed;
+	Timer *next;
+};
+
+typedef struct {
+	Window win;
+	Bool blocked;
+} EventScan;
+
+#define MAXBUSY 16
+#define PRIORITY_INTERVAL 64	/* number of queued events handled between two scans for input events */
+
+typedef struct {
+	Window busy[MAXBUSY];	/* windows with queued map/unmap/destroy events */
+	int nbusy;
+	Bool released;	/* a ButtonRelease is queued ahead */
+} PriorityScan;
+
 typedef struct Monitor Monitor;
 typedef struct Client Client;
+typedef struct Icon Icon;
+struct Icon {
+	unsigned long long hash;	/* of the source image's pixels, clients with the same icon share it */
+	int w, h;	/* size of the source image */
+	unsigned int size;	/* width and height in pixels */
+	Pixmap pixmap;
+	Pixmap mask;	/* 1 bit alpha, the bars are drawn without XRender */
+	int refs;	/* clients using the icon */
+	Icon *next;
+};
+
 struct Client {
 	char name[256];
+	char class[64];	/* WM_CLASS class, for the window switcher */
 	float mina, maxa;
 	int x, y, w, h;
 	int oldx, oldy, oldw, oldh;
 	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
 	int bw, oldbw;
-	unsigned int tags;
+	Tagset tags;
 	Bool wasfloating, isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, minimized, onscreen, marked;
+	Bool outline;	/* move/resize with the mouse using an outline instead of live updates */
+	int scratchpad;	/* index into scratchpads plus one, 0 if the client isn't a scratchpad */
+	pid_t pid;	/* local process owning the window according to _NET_WM_PID, 0 if there is none, -1 if not looked up yet */
+	Bool deprioritize;	/* its process may be deprioritized while hidden, see update_priorities */
+	unsigned long rss;	/* resident memory of its process in KiB, see update_resources */
+	unsigned long pixmapbytes;	/* X server memory held in pixmaps by its X connection */
+	unsigned int xresources;	/* X server resources (windows, pixmaps, GCs, ...) of its X connection */
+	Icon *icon;	/* scaled _NET_WM_ICON, NULL if there is none, see update_icon */
+	Bool iconloaded;	/* icon was read, see update_icon */
+	Pixmap thumb;	/* last thumbnail taken for the preview, kept until the next one, see preview_capture */
+	int thumbw, thumbh;
+	Bool redirected;	/* the window is redirected offscreen (automatically) while it is previewed */
+	int snapx, snapy, snapw, snaph;	/* outer geometry as recorded in the snapping index */
+	long hintflags;	/* flags of the WM_NORMAL_HINTS property */
+	unsigned long cfgreqs;	/* ConfigureRequests received */
+	unsigned long cfgapplied;	/* ConfigureRequests applied after coalescing */
+	Rate cfgrate;
+	Timer titletimer;	/* pending (debounced) title refresh */
+	Atom homemon;	/* name of the monitor the client was evacuated from when its output went away, if any */
+	Bool shown;	/* the window is at its on-screen position, see update_visibility */
+	long wmstate;	/* last WM_STATE set on the window */
+	long long titletime;	/* time of the last title refresh */
 	Client *next;
 	Client *snext;
 	Monitor *mon;
+	Monitor *snapmon;	/* monitor whose snapping index holds the client's edges, if any */
 	Window win;
 };
 
+typedef struct {
+	void (*func)(const Arg *);
+	Arg arg;
+} Action;
+
+typedef struct {
+	const char *name;
+	void (*func)(const Arg *);
+	int argtype;
+} IpcCommand;
+
+#define MAXACTIONS 32	/* commands per _WASDWM_COMMAND string */
+
 typedef struct {
 	unsigned int mod;
 	KeySym keysym;
@@ -86,6 +212,27 @@ typedef struct {
 	const Arg arg;
 } Key;
 
+#define MAXCHORD 4	/* keys per key sequence */
+
+typedef struct {
+	unsigned int mod;
+	KeySym keysym;
+} KeyStroke;
+
+typedef struct {
+	KeyStroke keys[MAXCHORD];	/* terminated by NoSymbol if shorter */
+	void (*func)(const Arg *);
+	const Arg arg;
+} Chord;
+
+typedef struct KeyNode KeyNode;
+struct KeyNode {
+	KeyStroke key;
+	const Chord *chord;	/* the sequence ending with this key, NULL if it only continues */
+	KeyNode *child;	/* keys that may follow */
+	KeyNode *next;	/* other keys at the same position */
+};
+
 typedef struct {
 	const char *symbol;
 	void (*arrange)(Monitor *);
@@ -93,8 +240,115 @@ typedef struct {
 
 typedef struct Pertag Pertag;
 
+typedef struct {
+	int pos;	/* coordinate of the edge, must come first (see get_lower_bound) */
+	int lo, hi;	/* extent of the edge along the other axis */
+	Client *c;
+} Edge;
+
+typedef struct {
+	Edge *edges;	/* sorted by pos */
+	int n, size;
+} EdgeIndex;
+
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	Client *c;
+	Rect r;
+	int bw;
+	Bool marked;
+} CachedGeom;
+
+typedef struct {
+	Bool valid;
+	unsigned long version;	/* Monitor.version the geometry was computed for */
+	Tagset tagset;
+	Rect area;
+	const Layout *layout;
+	float marked_width;
+	char layout_symbol[16];
+	CachedGeom *geoms;	/* tiled clients in list order */
+	int n, size;
+} LayoutCache;
+
+typedef struct {
+	int pos;
+	long long dslope;	/* change in the slope of the overlap function at pos */
+} SweepEvent;
+
+typedef struct {
+	Monitor **mons;	/* by number */
+	int n;
+	int *xs, *ys;	/* sorted distinct monitor edges */
+	int nx, ny;
+	Monitor **cells;	/* the (nx - 1) * (ny - 1) cells between the edges, NULL where no monitor covers them */
+} MonitorIndex;
+
 #define MAXTABS 50
 
+typedef struct {
+	const char *text;	/* shown and matched against the query */
+	void *data;
+} MenuItem;
+
+typedef struct {
+	char *path;	/* a directory from $PATH */
+	int wd;	/* inotify watch, -1 if the directory isn't watched */
+	time_t mtime;	/* modification time when the directory was scanned */
+	Bool stale;	/* the directory changed since it was scanned */
+	char *pool;	/* names of the executables in the directory */
+	size_t poolsize;
+	char **names;
+	int n;
+} PathDir;
+
+#define PATH_RESCAN_DELAY 250	/* milliseconds, collects bursts of changes to $PATH directories */
+
+#define MAXSPAWNS 32       /* spawned processes whose first window is awaited */
+#define MAXSPAWNSTATS 16   /* commands whose spawn-to-map latency is reported */
+#define SPAWNCMDLEN 32
+
+typedef struct {
+	pid_t pid;	/* 0 once the process mapped a window */
+	long long time;	/* see get_time_ms() */
+	char cmd[SPAWNCMDLEN];
+} Spawn;
+
+typedef struct {
+	char cmd[SPAWNCMDLEN];
+	unsigned int count;
+	long long last, max, total;	/* spawn-to-map latency in milliseconds */
+} SpawnStats;
+
+typedef struct {
+	Window win;	/* None while no preview is shown */
+	Client *c;	/* the hovered client, NULL if none */
+	Monitor *mon;
+	int x;	/* left edge of the hovered tab */
+} Preview;
+
+#define MENUQUERYLEN 256
+#define SWITCHERLABELLEN 328	/* Client.name, Client.class and decoration */
+
+typedef struct {
+	Window win;	/* None while the menu is closed */
+	Monitor *mon;
+	char query[MENUQUERYLEN];
+	unsigned int len;
+	unsigned int matchedlen;	/* length of the query the matches were filtered with, see menu_filter */
+	MenuItem *items;
+	int nitems;
+	char *strings;	/* storage of the item texts, if owned by the menu */
+	int *matches;	/* indexes into items, prefix matches first, otherwise in item order */
+	int *rest;	/* scratch space for menu_filter */
+	int nmatches;
+	int sel, top;	/* selected match and first visible match */
+	void (*select)(MenuItem *item, const char *query);	/* called with the chosen item, NULL if nothing matches */
+} Menu;
+
 struct Monitor {
 	char layout_symbol[16];
 	float marked_width;	/* a percentage of the viewable area */
@@ -106,7 +360,11 @@ struct Monitor {
 	int winarea_x, winarea_y, winarea_width, winarea_height;  /* window area  */
 	unsigned int selected_tags;
 	unsigned int selected_layout;
-	unsigned int tagset[2];
+	Tagset tagset[2];
+	Atom name;	/* RandR name of the monitor, identifies it across configuration changes */
+	Bool dirty;	/* geometry changed since the monitor was last arranged */
+	unsigned int deferred;	/* DeferArrange, DeferRestack and DeferDraw flags, see run_actions */
+	unsigned long version;	/* bumped when clients come or go or change their size hints, see layout_cache_apply */
 	Bool show_tagbar;
 	Bool show_clientbar;
 	Bool tags_on_top;
@@ -115,8 +373,11 @@ struct Monitor {
 	Client *top;
 	Client *stack;
 	Monitor *next;
+	EdgeIndex xedges, yedges;	/* edges of floating clients, used for snapping */
+	Monitor *neighbours[DirLast];	/* nearest monitor in each direction, see monitor_index_update */
 	Window tagbar_win;
 	Window clientbar_win;
+	Window crossing_win;	/* InputOnly window below all clients, reports the pointer entering the monitor */
 	int num_client_tabs;
 	int client_tab_widths[MAXTABS];
 	const Layout *layout[2];
@@ -127,11 +388,40 @@ typedef struct {
 	const char *class;
 	const char *instance;
 	const char *title;
-	unsigned int tags;
+	unsigned long long tags;	/* bit i puts the client on tags[i] (so only the first 64 tags), 0 to use the monitor's current tags */
 	Bool isfloating;
+	Bool outline;
 	int monitor;
+	int deprioritize;	/* -1 to use deprioritize_hidden */
 } Rule;
 
+typedef struct {
+	const char *instance;	/* WM_CLASS instance the command's window is recognized by */
+	const char **cmd;
+	Bool prespawn;	/* spawn at startup rather than on first use */
+} Scratchpad;
+
+#define MAXPROCPRIOS 64	/* processes whose priority is tracked */
+
+typedef struct {
+	pid_t pid;
+	long long hiddensince;	/* see get_time_ms(), 0 while one of its windows is visible */
+	Bool lowered;
+	int nice;	/* nice value before it was lowered */
+	char cgroup[256];	/* cgroup v2 it was moved out of, empty if it was reniced instead */
+} ProcPriority;
+
+#define SCRATCHPAD_SPAWN_TIMEOUT 5000	/* milliseconds to wait for a scratchpad's window before spawning it again */
+
+typedef struct {
+	float marked_width;
+	unsigned int selected_layout;
+	const Layout *layoutidxs[2];
+	Bool show_tagbar;
+	LayoutCache cache;	/* geometry computed by the layout when the tag was last arranged */
+	Client *sel;	/* client last selected while the tag was current */
+} TagState;
+
 typedef struct {
 	unsigned long rgb;
 } Color;
@@ -175,41 +465,62 @@ void arrange_monocle (Monitor *m);
 void arrange_tile (Monitor *m);
 void attach (Client *c);
 Client *attach_recursive (Client *c, Client *pos);
+void benchmark_placement (void);
+void chord_build (void);
+void chord_cancel (void *unused);
+void chord_free (KeyNode *n);
+Bool chord_press (XKeyEvent *ev, KeySym keysym);
 void cleanup (void);
+void clear_tag_selection (Client *c);
 void clear_urgent (Client *c);
 void cmd_adjust_marked_width (const Arg *arg);
 void cmd_cycle_focus (const Arg *arg);
 void cmd_cycle_focus_monitor (const Arg *arg);
 void cmd_cycle_stackarea_selection (const Arg *arg);
+void cmd_create_tag (const Arg *arg);
 void cmd_cycle_view (const Arg *arg);
+void cmd_destroy_tag (const Arg *arg);
 void cmd_drag_window (const Arg *arg);
 void cmd_focus_client (const Arg* arg);
+void cmd_focus_monitor (const Arg *arg);
 void cmd_hide_window (const Arg *arg);
 void cmd_kill_client (const Arg *arg);
+void cmd_launch (const Arg *arg);
+void cmd_name_tag (const Arg *arg);
 void cmd_push_client_left (const Arg *arg);
 void cmd_push_client_right (const Arg *arg);
 void cmd_quit (const Arg *arg);
 void cmd_resize_with_mouse (const Arg *arg);
+void cmd_restart (const Arg *arg);
+void cmd_run_macro (const Arg *arg);
+void cmd_sample_resources (const Arg *arg);
 void cmd_send_to_monitor (const Arg *arg);
 void cmd_set_clientbar_mode (const Arg *arg);
 void cmd_set_layout (const Arg *arg);
 void cmd_set_marked_width (const Arg *arg);
 void cmd_shift_tag (const Arg *arg);
 void cmd_spawn (const Arg *arg);
+void cmd_switch_client (const Arg *arg);
 void cmd_tag_client (const Arg *arg);
 void cmd_toggle_floating (const Arg *arg);
 void cmd_toggle_fullscreen (const Arg *arg);
 void cmd_toggle_hidden (const Arg *arg);
 void cmd_toggle_mark (const Arg *arg);
+void cmd_toggle_scratchpad (const Arg *arg);
 void cmd_toggle_tag (const Arg *arg);
 void cmd_toggle_tagbar (const Arg *arg);
 void cmd_toggle_tag_view (const Arg *arg);
 void cmd_view_tag (const Arg *arg);
 Color *color_create (Graphics *drw, const char *clrname);
 void color_free (Color *clr);
+unsigned long color_rgb_to_pixel (Visual *visual, unsigned long rgb);
 void configure (Client *c);
 void detach (Client *c);
 void die (const char *errstr, ...);
+void dispatch_priority_events (void);
+void edge_index_insert (EdgeIndex *idx, int pos, int lo, int hi, Client *c);
+int edge_index_nearest (EdgeIndex *idx, int pos, int lo, int hi, Client *skip);
+void edge_index_remove (EdgeIndex *idx, int pos, Client *c);
 Monitor *direction_to_monitor (int dir);
 void draw_tagbar (Monitor *m);
 void draw_bars (void);
@@ -223,23 +534,39 @@ void event_enter_notify (XEvent *e);
 void event_expose (XEvent *e);
 void event_focus_in (XEvent *e);
 void event_key_press (XEvent *e);
+void event_leave_notify (XEvent *e);
 void event_mapping_notify (XEvent *e);
 void event_map_request (XEvent *e);
 void event_motion_notify (XEvent *e);
 void event_property_notify (XEvent *e);
+#ifdef XRANDR
+void event_randr_notify (XEvent *e);
+#endif /* XRANDR */
 void event_unmap_notify (XEvent *e);
+void evacuate_monitor (Monitor *m, Monitor *target);
 void focus (Client *c);
 void focus_root (void);
 FontStruct *font_create (Display *dpy, const char *fontname);
 void font_free (Display *dpy, FontStruct *font);
 void font_get_text_extents (FontStruct *font, const char *text, unsigned int len, Extents *extnts);
 unsigned int font_get_text_width (FontStruct *font, const char *text, unsigned int len);
+Bool fuzzy_match (const char *query, const char *text);
+Icon *get_client_icon (Client *c);
+const char *get_client_label (Client *c);
+pid_t get_client_pid (Client *c);
+Client *get_client_tab (Monitor *m, int x, int *tabx, int *tab);
+int get_lower_bound (const void *a, int n, size_t size, int v);
+unsigned long get_process_rss (pid_t pid);
 Bool get_prop_text (Window w, Atom atom, char *text, unsigned int size);
 Bool get_root_pointer_pos (int *x, int *y);
 long get_state (Window w);
+Client *get_tag_selection (Monitor *m);
+TagState *get_tag_state (Monitor *m, unsigned int curtag);
+long long get_time_ms (void);
 void grab_buttons (Client *c, Bool focused);
 void grab_shortcut_keys (void);
 Graphics *gfx_create (Display *dpy, int screen, Window win, unsigned int w, unsigned int h);
+void gfx_draw_icon_text (Graphics *drw, int x, int y, unsigned int w, unsigned int h, Icon *icon, const char *text);
 void gfx_draw_rect (Graphics *drw, int x, int y, unsigned int w, unsigned int h, int filled, int empty);
 void gfx_draw_text (Graphics *drw, int x, int y, unsigned int w, unsigned int h, const char *text);
 void gfx_free (Graphics *drw);
@@ -247,42 +574,128 @@ void gfx_render_to_window (Graphics *drw, Window win, int x, int y, unsigned int
 void gfx_resize (Graphics *drw, unsigned int w, unsigned int h);
 void gfx_set_font (Graphics *drw, FontStruct *font);
 void gfx_set_colorscheme (Graphics *drw, ColorScheme *scheme);
+Icon *icon_create (const unsigned long *argb, int w, int h);
+void icon_release (Icon *icon);
+void icon_scale (const unsigned long *src, int sw, int sh, unsigned long *dst, int dw, int dh);
 void init_bars (void);
+void intern_atoms (void);
+Bool layout_cache_apply (Monitor *m);
+void launcher_select (MenuItem *item, const char *query);
+void layout_cache_store (Monitor *m);
+void log_startup_phase (const char *phase);
 void manage (Window w, XWindowAttributes *wa);
+void menu_close (void);
+void menu_draw (void);
+void menu_filter (void);
+Bool menu_key (XKeyEvent *ev);
+void menu_open (MenuItem *items, int nitems, char *strings, void (*select)(MenuItem *item, const char *query));
+void menu_remove (void *data);
 void monitor_cleanup (Monitor *mon);
 Monitor *monitor_create (void);
+void monitor_index_update (void);
+int next_occupied_tag (Monitor *m, int dir);
 Client *next_tiled (Client *c);
+void outline_create (void);
+void outline_free (void);
+void outline_move (int x, int y, int w, int h);
+void path_index_free (void);
+void path_index_init (void);
+void path_index_read (void);
+void path_index_scan_dir (PathDir *d);
+void path_index_update (void *unused);
+Bool path_index_watch (PathDir *d);
+void place_client (Client *c);
+Monitor *point_to_monitor (int x, int y);
 void pop (Client *c);
 Client *prev_tiled (Client *c);
+Bool preview_capture (Client *c);
+void preview_close (void);
+Bool preview_redirect (Client *c);
+void preview_unredirect (Client *c);
+void preview_update (void *unused);
+void priority_init (void);
+void priority_lower (ProcPriority *p);
+void priority_restore (ProcPriority *p);
+Bool priority_set_nice (pid_t pid, int nice);
+Bool priority_write (const char *dir, const char *file, const char *text);
+void rate_add (Rate *r, unsigned int n);
+unsigned int rate_get (Rate *r);
 Monitor *rect_to_monitor (int x, int y, int w, int h);
+void refresh_title (void *arg);
 void resize (Client *c, int x, int y, int w, int h, Bool interact);
 void resize_client (Client *c, int x, int y, int w, int h);
 void restack (Monitor *m);
+Bool restore_state (Window *wins, unsigned int num);
+void run_actions (const Action *actions, int n);
+void run_command_string (char *cmds);
+void run_timers (void);
+void save_state (void);
 void scan (void);
+void schedule_priority_update (void);
+void schedule_stats_update (void);
+void schedule_title_update (Client *c);
+Client *scratchpad_client (int i);
+void scratchpad_prespawn (void);
+void scratchpad_spawn (int i);
 Bool send_event (Client *c, Atom proto);
 void send_client_to_monitor (Client *c, Monitor *m);
 void set_client_state (Client *c, long state);
 void set_fullscreen (Client *c, Bool fullscreen);
 void setup (void);
 void sigchld (int unused);
+void snap_index_remove (Client *c);
+void snap_index_update (Client *c);
+void snap_to_clients (Client *c, int *x, int *y);
+void spawn_match (Client *c);
+void spawn_record (pid_t pid, char **argv);
 void stack_attach (Client *c);
 void stack_detach (Client *c);
+void stage_adjacent_tags (void *unused);
+void stage_tag (Monitor *m, int tag);
+void switcher_select (MenuItem *item, const char *query);
+void tagset_and (Tagset *dst, const Tagset *src);
+Bool tagset_empty (const Tagset *s);
+Bool tagset_equal (const Tagset *a, const Tagset *b);
+int tagset_first (const Tagset *s);
+Bool tagset_intersects (const Tagset *a, const Tagset *b);
+void tagset_or (Tagset *dst, const Tagset *src);
+void timer_arm (Timer *t, int delay);
+void timer_disarm (Timer *t);
+int timer_next_delay (void);
 void unfocus (Client *c);
 void unmanage (Client *c, Bool destroyed);
 void update_client_list (void);
 Bool update_geometry (void);
+#ifdef XRANDR
+Bool update_geometry_randr (void);
+#endif /* XRANDR */
 void update_bar_positions (Monitor *m);
+void update_icon (Client *c);
 void update_numlock_mask (void);
 void update_onscreen (Monitor *m);
+void update_priorities (void *unused);
+void update_resources (void *unused);
+void update_screens (void *unused);
 void update_size_hints (Client *c);
 void update_statusarea (void);
+void update_stats (void *unused);
 void update_title (Client *c);
 void update_visibility (Client *c);
+void update_window_area (Monitor *m);
 void update_window_type (Client *c);
 void update_wm_hints (Client *c);
+void view_tagset (const Tagset *ts);
 Client *window_to_client (Window w);
 Monitor *window_to_monitor (Window w);
 int _cmpint (const void *p1, const void *p2);
+int _cmpstr (const void *p1, const void *p2);
+int _cmpsweep (const void *p1, const void *p2);
+int _cmpwin (const void *p1, const void *p2);
+#ifdef XRES
+int _cmpxresclient (const void *p1, const void *p2);
+#endif /* XRES */
+Bool _pending_configure_request (Display *dpy, XEvent *ev, XPointer arg);
+Bool _priority_event (Display *dpy, XEvent *ev, XPointer arg);
 int _xerror (Display *dpy, XErrorEvent *ee);
 int _xerrordummy (Display *dpy, XErrorEvent *ee);
 int _xerrorstart (Display *dpy, XErrorEvent *ee);
@@ -290,15 +703,58 @@ int _xerrorstart (Display *dpy, XErrorEvent *ee);
 #include "config.h"
 
 struct Pertag {
-	unsigned int curtag, prevtag; /* current and previous tag */
-	float marked_widths[LENGTH(tags) + 1]; /* marked_widths per tag */
-	unsigned int selected_layouts[LENGTH(tags) + 1]; /* selected layouts */
-	const Layout *layoutidxs[LENGTH(tags) + 1][2]; /* matrix of tags and layouts indexes  */
-	Bool show_tagbars[LENGTH(tags) + 1]; /* display bar for the current tag */
+	unsigned int curtag, prevtag; /* current and previous tag, 0 when viewing all tags and i + 1 for tag i */
+	TagState *tags[MAXTAGS + 1]; /* indexed like curtag, allocated on demand by get_tag_state */
 };
 
-/* compile-time check if all tags fit into an unsigned int bit array. */
-struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+/* state handed over to the new process by cmd_restart (see save_state and restore_state) */
+#define STATE_MAGIC 0x77617364 /* "wasd" */
+
+typedef struct {
+	unsigned int magic;
+	unsigned int size;	/* sizeof(StateHeader) + sizeof(MonitorState) + sizeof(ClientState), catches incompatible builds */
+	int nmons, nclients;
+	int selmon;
+	Tagset tagmask;
+	char tagnames[MAXTAGS][TAGNAMELEN];
+} StateHeader;
+
+typedef struct {
+	int num;
+	Window sel;
+	float marked_width;
+	unsigned int selected_tags, selected_layout;
+	Tagset tagset[2];
+	int layout[2];	/* indexes into layouts */
+	int show_clientbar;
+	Bool show_tagbar, tags_on_top;
+	unsigned int curtag, prevtag;
+	Bool pertag[MAXTAGS + 1];	/* whether the state of the tag was allocated */
+	float marked_widths[MAXTAGS + 1];
+	unsigned int selected_layouts[MAXTAGS + 1];
+	int layoutidxs[MAXTAGS + 1][2];
+	Bool show_tagbars[MAXTAGS + 1];
+} MonitorState;
+
+typedef struct {
+	Window win;
+	int mon;	/* monitor number */
+	int stackpos;	/* position in the monitor's focus stack */
+	Tagset tags;
+	int x, y, w, h, oldx, oldy, oldw, oldh, bw, oldbw;
+	int basew, baseh, incw, inch, maxw, maxh, minw, minh;
+	float mina, maxa;
+	long hintflags;
+	Bool wasfloating, isfixed, isfloating, isurgent, neverfocus, oldstate, isfullscreen, minimized, marked, outline;
+	int scratchpad;
+	Bool deprioritize;
+	pid_t pid;
+	char name[256];
+	char class[64];
+} ClientState;
+
+/* compile-time check if all configured tags fit into the tag slots. */
+struct NumTags { char limitexceeded[LENGTH(tags) > MAXTAGS ? -1 : 1]; };
 
 /* a global variable that maps event types to handlers */
 void (*handler[LASTEvent]) (XEvent *) = {
@@ -311,9 +767,48 @@ void (*handler[LASTEvent]) (XEvent *) = {
 	[Expose] = event_expose,
 	[FocusIn] = event_focus_in,
 	[KeyPress] = event_key_press,
+	[LeaveNotify] = event_leave_notify,
 	[MappingNotify] = event_mapping_notify,
 	[MapRequest] = event_map_request,
 	[MotionNotify] = event_motion_notify,
 	[PropertyNotify] = event_property_notify,
 	[UnmapNotify] = event_unmap_notify
 };
+
+/* commands that can be run through the _WASDWM_COMMAND property of the root window, see run_command_string */
+const IpcCommand ipc_commands[] = {
+	{ "adjust_marked_width",       cmd_adjust_marked_width,       ArgFloat },
+	{ "create_tag",                cmd_create_tag,                ArgString },
+	{ "cycle_focus",               cmd_cycle_focus,               ArgInt },
+	{ "cycle_focus_monitor",       cmd_cycle_focus_monitor,       ArgInt },
+	{ "cycle_stackarea_selection", cmd_cycle_stackarea_selection, ArgInt },
+	{ "cycle_view",                cmd_cycle_view,                ArgInt },
+	{ "destroy_tag",               cmd_destroy_tag,               ArgNone },
+	{ "focus_client",              cmd_focus_client,              ArgInt },
+	{ "focus_monitor",             cmd_focus_monitor,             ArgInt },
+	{ "hide_window",               cmd_hide_window,               ArgNone },
+	{ "kill_client",               cmd_kill_client,               ArgNone },
+	{ "launch",                    cmd_launch,                    ArgNone },
+	{ "name_tag",                  cmd_name_tag,                  ArgString },
+	{ "push_client_left",          cmd_push_client_left,          ArgNone },
+	{ "push_client_right",         cmd_push_client_right,         ArgNone },
+	{ "quit",                      cmd_quit,                      ArgNone },
+	{ "restart",                   cmd_restart,                   ArgNone },
+	{ "sample_resources",          cmd_sample_resources,          ArgNone },
+	{ "send_to_monitor",           cmd_send_to_monitor,           ArgInt },
+	{ "set_clientbar_mode",        cmd_set_clientbar_mode,        ArgInt },
+	{ "set_layout",                cmd_set_layout,                ArgLayout },
+	{ "set_marked_width",          cmd_set_marked_width,          ArgFloat },
+	{ "shift_tag",                 cmd_shift_tag,                 ArgInt },
+	{ "switch_client",             cmd_switch_client,             ArgNone },
+	{ "tag_client",                cmd_tag_client,                ArgTag },
+	{ "toggle_floating",           cmd_toggle_floating,           ArgNone },
+	{ "toggle_fullscreen",         cmd_toggle_fullscreen,         ArgNone },
+	{ "toggle_hidden",             cmd_toggle_hidden,             ArgInt },
+	{ "toggle_mark",               cmd_toggle_mark,               ArgNone },
+	{ "toggle_scratchpad",         cmd_toggle_scratchpad,         ArgInt },
+	{ "toggle_tag",                cmd_toggle_tag,                ArgTag },
+	{ "toggle_tagbar",             cmd_toggle_tagbar,             ArgNone },
+	{ "toggle_tag_view",           cmd_toggle_tag_view,           ArgTag },
+	{ "view_tag",                  cmd_view_tag,                  ArgTag },
+};